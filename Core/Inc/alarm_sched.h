@@ -0,0 +1,61 @@
+/*
+ * alarm_sched.h
+ *
+ *  Bộ lập lịch nhiều báo thức. Thời điểm tính bằng giây từ 2000-01-01 00:00:00
+ *  (cùng trục với cur_sec của app). Lần kích kế tiếp của mỗi báo thức được tính
+ *  sẵn và giữ trong min-heap: mỗi tick chỉ so một giá trị, không phụ thuộc số
+ *  báo thức; chỉ tính lại khi sửa hoặc khi kích.
+ */
+
+#ifndef INC_ALARM_SCHED_H_
+#define INC_ALARM_SCHED_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define ALARM_MAX			32
+#define ALARM_NONE			0xFFFFFFFFu		// không có hạn kế tiếp
+
+typedef enum {
+	ALARM_ONESHOT = 0,		// at = thời điểm tuyệt đối, tự tắt sau khi kích
+	ALARM_DAILY,			// at = giây trong ngày
+	ALARM_WEEKLY,			// at = giây trong ngày, days = các thứ được phép
+	ALARM_EVERY_N_MIN		// at = mốc bắt đầu, lặp mỗi period_min phút
+} alarm_kind_t;
+
+/* Mặt nạ thứ cho ALARM_WEEKLY (2000-01-01 là thứ Bảy) */
+#define ALARM_SUN			0x01
+#define ALARM_MON			0x02
+#define ALARM_TUE			0x04
+#define ALARM_WED			0x08
+#define ALARM_THU			0x10
+#define ALARM_FRI			0x20
+#define ALARM_SAT			0x40
+#define ALARM_WORKDAYS		(ALARM_MON | ALARM_TUE | ALARM_WED | ALARM_THU | ALARM_FRI)
+
+typedef struct {
+	uint32_t at;
+	uint16_t period_min;
+	uint8_t  kind;			// alarm_kind_t
+	uint8_t  days;
+} alarm_rule_t;
+
+void alarm_init(void);
+
+/* Trả id (0..ALARM_MAX-1) hoặc -1 nếu đầy */
+int  alarm_add(const alarm_rule_t *r, bool enabled, uint32_t now);
+/* Thay quy tắc / bật-tắt / xoá: O(log n) */
+void alarm_update(int id, const alarm_rule_t *r, bool enabled, uint32_t now);
+void alarm_remove(int id);
+
+/* Giờ bị đặt lại: tính lại toàn bộ (O(n), chỉ khi sửa giờ) */
+void alarm_reschedule_all(uint32_t now);
+
+/* Hạn gần nhất trong mọi báo thức, O(1) */
+uint32_t alarm_next_deadline(void);
+
+/* Lấy một báo thức đã đến hạn (next <= now) và xếp lần kích kế tiếp;
+ * -1 nếu không có. Gọi lặp đến khi -1. */
+int  alarm_take_due(uint32_t now);
+
+#endif /* INC_ALARM_SCHED_H_ */
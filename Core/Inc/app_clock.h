@@ -7,22 +7,25 @@
 typedef enum {
   MODE_VIEW = 0,     // Xem giờ
   MODE_SET_TIME,     // Chỉnh giờ/ngày
-  MODE_ALARM         // Hẹn giờ
+  MODE_ALARM,        // Hẹn giờ
+  MODE_STOPWATCH,    // Bấm giờ (OK: chạy/dừng, UP: vòng/xoá)
+  MODE_COUNTDOWN     // Đếm ngược (OK: chạy/dừng, UP: +1 phút/về đầu)
 } app_mode_t;
 
 typedef enum {
   FIELD_SEC = 0,
   FIELD_MIN,
   FIELD_HOUR,
-  FIELD_DAY,   // 1..7
-  FIELD_DATE,  // 1..31 (đơn giản)
+  FIELD_DAY,   // 1..7, suy ra từ ngày (không chỉnh)
+  FIELD_DATE,  // 1..số ngày của tháng
   FIELD_MONTH, // 1..12
   FIELD_YEAR,  // 0..99 (2000..2099)
   FIELD_COUNT
 } field_t;
 
+/** Khởi tạo và đăng ký các task (input/logic/ui/rtc) với sched */
 void app_clock_init(void);
-/** Gọi mỗi tick (ví dụ 50 ms) sau khi đã button_Scan() */
-void app_clock_on_tick(void);
+/** Gọi khi flag_oneshot bật: lật giây đúng ranh giới giây của DS3231 */
+void app_clock_on_second(void);
 
 #endif // APP_CLOCK_H
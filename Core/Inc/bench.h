@@ -0,0 +1,84 @@
+/*
+ * bench.h
+ *
+ *  Chế độ benchmark trên chip: giữ OK lúc bật nguồn thì trước khi vào đồng hồ
+ *  chạy một chuỗi đo cố định bằng DWT->CYCCNT ở CLK_PERF, in kết quả lên LCD
+ *  và chờ một phím. Bảng bench_results ở lại trong RAM cho debugger đọc:
+ *
+ *      (gdb) p bench_env
+ *      (gdb) p bench_results
+ *
+ *  Số đo là của board và timing FSMC/I2C đang nạp (bench_env ghi lại cả hai).
+ *  Bản build không có DEBUG (hoặc BENCH_ENABLE=0): bench_requested() luôn 0,
+ *  không tốn flash.
+ */
+
+#ifndef INC_BENCH_H_
+#define INC_BENCH_H_
+
+#include <stdint.h>
+#include "main.h"
+
+/* Chỉ bản DEBUG như prof/trace/dlog: bản phát hành không quét phím chặn lúc
+ * khởi động và không bao giờ ghi đè thanh ghi alarm DS3231 (BENCH_I2C_WRITE) */
+#ifndef BENCH_ENABLE
+#ifdef DEBUG
+#define BENCH_ENABLE 1
+#else
+#define BENCH_ENABLE 0
+#endif
+#endif
+
+/* Phím giữ lúc khởi động để vào benchmark (chỉ số như button_count) */
+#ifndef BENCH_KEY_IDX
+#define BENCH_KEY_IDX	2
+#endif
+
+typedef enum {
+	BENCH_FILL = 0,		// lcd_Fill toàn màn            (điểm ảnh/s)
+	BENCH_GLYPH,		// lcd_ShowChar 24 px nền đặc   (ký tự/s)
+	BENCH_LINE,			// lcd_DrawLine chéo 100 px     (đường/s)
+	BENCH_CIRCLE,		// lcd_DrawCircle đặc r = 50    (hình/s)
+	BENCH_I2C_READ,		// ds3231_GetTime, 7 byte       (độ trễ)
+	BENCH_I2C_WRITE,	// ghi lại 7 byte alarm 0x07..0x0D (độ trễ)
+	BENCH_SPI_SCAN,		// button_Scan tới khi SPI xong (độ trễ)
+	BENCH_TIM2_ISR,		// vào + ra TIM2_IRQHandler qua CC1 (độ trễ)
+	BENCH_N
+} bench_id_t;
+
+typedef struct {
+	const char *name;
+	uint32_t ops;			// số lần đo
+	uint32_t units;			// đơn vị công việc mỗi lần (điểm ảnh, ký tự...)
+	uint32_t cyc_min;		// chu kỳ HCLK mỗi lần
+	uint32_t cyc_max;
+	uint64_t cyc_total;
+	uint32_t per_s;			// units/s theo trung bình
+	uint32_t ns_avg;		// ns mỗi lần
+} bench_result_t;
+
+typedef struct {
+	uint32_t hclk_hz;
+	uint32_t i2c_hz;
+	uint32_t fsmc_btr;		// FSMC_BTR1: timing đọc (ADDSET [3:0], DATAST [15:8])
+	uint32_t fsmc_bwtr;		// FSMC_BWTR1: timing ghi
+} bench_env_t;
+
+extern bench_env_t    bench_env;
+extern bench_result_t bench_results[BENCH_N];
+
+#if BENCH_ENABLE
+
+/* Sau timer_init + clk_gov_init: quét phím vài ms, 1 nếu BENCH_KEY_IDX đang giữ */
+uint8_t bench_requested(void);
+/* Chạy cả chuỗi, vẽ kết quả, chờ một phím. Gọi trước sched_init */
+void    bench_run(void);
+
+#else
+
+#define bench_requested()	((uint8_t)0)
+#define bench_run()			((void)0)
+
+#endif
+
+#endif /* INC_BENCH_H_ */
@@ -11,10 +11,23 @@
 #include <stdint.h>   // <-- bổ sung
 #include "main.h"     // để có HAL & pin define nếu cần
 
-extern uint16_t button_count[16];
+/* Giữ liên tục ở mức nhấn bao lâu mới tính là nhấn (chống dội). Tính theo
+ * mốc TIM2 của các lần quét, không theo số lần quét: lượt quét bị trễ/bỏ
+ * vì quá tải không kéo dài thời gian chống dội */
+#ifndef BUTTON_DEBOUNCE_US
+#define BUTTON_DEBOUNCE_US     10000
+#endif
+
+extern uint16_t button_count[16];   // số lần quét liên tiếp thấy nhấn
+extern uint16_t button_down;        // nút đã qua chống dội, bit theo chỉ số
+extern uint64_t button_scan_us;
+extern uint64_t button_press_us[16];
 
 void button_init();
+/* Khởi động một lần đọc SPI (ngắt); kết quả giải mã trong PendSV */
 void button_Scan();
+/* Lấy (và xoá) mặt nạ các nút vừa có cạnh nhấn kể từ lần gọi trước */
+uint16_t button_TakeEdges(void);
 
 
 #endif /* INC_BUTTON_H_ */
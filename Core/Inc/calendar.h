@@ -0,0 +1,48 @@
+/*
+ * calendar.h
+ *
+ *  Số học lịch cho 2000..2099 trên bố cục thanh ghi DS3231 (ds3231_time_t).
+ *  Trục thời gian: giây từ 2000-01-01 00:00:00. Mọi phép đổi là O(1) bằng
+ *  bảng tra, không lặp theo năm/ngày.
+ *  Thứ (day): 1 = Chủ nhật .. 7 = thứ Bảy, luôn suy ra từ ngày tháng năm.
+ */
+
+#ifndef INC_CALENDAR_H_
+#define INC_CALENDAR_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ds3231.h"
+
+#define CAL_SEC_PER_DAY		86400u
+
+static inline bool cal_is_leap(uint8_t year){
+	return (year % 4u) == 0;		// 2000 chia hết cho 400 nên vẫn nhuận
+}
+
+uint8_t  cal_days_in_month(uint8_t month, uint8_t year);
+
+/* Thứ của ngày thứ `days` kể từ 2000-01-01 (thứ Bảy) */
+static inline uint8_t cal_weekday_of_days(uint32_t days){
+	return (uint8_t)((days + 6u) % 7u + 1u);
+}
+uint8_t  cal_weekday(uint8_t date, uint8_t month, uint8_t year);
+
+uint32_t cal_to_sec(const ds3231_time_t *t);
+void     cal_from_sec(uint32_t s, ds3231_time_t *t);
+
+static inline void cal_add_sec(ds3231_time_t *t, int32_t delta){
+	cal_from_sec(cal_to_sec(t) + (uint32_t)delta, t);
+}
+/* <0, 0, >0 như strcmp */
+static inline int cal_compare(const ds3231_time_t *a, const ds3231_time_t *b){
+	uint32_t sa = cal_to_sec(a), sb = cal_to_sec(b);
+	return (sa > sb) - (sa < sb);
+}
+
+/* Trường nằm trong miền hợp lệ và thứ khớp với ngày */
+bool     cal_valid(const ds3231_time_t *t);
+/* Kẹp date theo số ngày của tháng, kẹp các trường khác và suy ra thứ */
+void     cal_normalize(ds3231_time_t *t);
+
+#endif /* INC_CALENDAR_H_ */
@@ -0,0 +1,46 @@
+/*
+ * clock_gov.h
+ *
+ *  Điều tốc clock: chạy 168 MHz khi vẽ, hạ xuống khi rảnh.
+ *   - CLK_PERF: PLL 168 MHz, APB /4      (TIM2 84 MHz)
+ *   - CLK_MID : PLL, AHB /2 = 84 MHz, APB /2  — PCLK1/PCLK2/TIM2 giữ nguyên nên
+ *               đổi PERF <-> MID chỉ là một lần ghi CFGR, không đụng ngoại vi
+ *   - CLK_LOW : HSI 16 MHz trực tiếp, tắt PLL (TIM2 16 MHz, PSC được tính lại,
+ *               I2C/SPI khởi tạo lại theo PCLK mới)
+ *  TIM2 luôn đếm 1 MHz liên tục qua mọi lần đổi (timer_retime).
+ *  Chỉ gọi từ vòng chính.
+ */
+
+#ifndef INC_CLOCK_GOV_H_
+#define INC_CLOCK_GOV_H_
+
+#include <stdint.h>
+#include "main.h"
+
+typedef enum {
+	CLK_PERF = 0,
+	CLK_MID,
+	CLK_LOW,
+	CLK_PROFILE_N
+} clk_profile_t;
+
+/* Rảnh liên tục bao lâu (ở MID) thì mới tắt PLL xuống LOW */
+#define CLK_LOW_AFTER_MS	200
+/* Tốc độ SPI tối đa cho thanh ghi dịch nút */
+#define CLK_SPI_MAX_HZ		21000000u
+
+void              clk_gov_init(void);
+/* Đổi profile ngay. HAL_BUSY: I2C/SPI đang chạy mà profile mới đổi PCLK */
+HAL_StatusTypeDef clk_gov_set(clk_profile_t p);
+clk_profile_t     clk_gov_profile(void);
+
+/* Trước việc nặng (vẽ): lên PERF. Sau đó: về MID và bắt đầu đếm rảnh */
+void              clk_gov_boost(void);
+void              clk_gov_relax(void);
+/* Gọi trước khi ngủ: đủ lâu không có việc nặng thì xuống LOW */
+void              clk_gov_idle(void);
+
+/* Thời gian ở từng profile (µs, từ lúc init) */
+uint64_t          clk_gov_residency_us(clk_profile_t p);
+
+#endif /* INC_CLOCK_GOV_H_ */
@@ -0,0 +1,84 @@
+/*
+ * dlog.h
+ *
+ *  Log định dạng hoãn: trên chip chỉ ghi vị trí chuỗi định dạng và các tham
+ *  số thô (tối đa 4, mỗi cái 32 bit) vào vòng RAM, không gọi printf:
+ *
+ *      DLOG("i2c lỗi %u ở reg 0x%02x", status, reg);
+ *
+ *  Chuỗi định dạng nằm trong section dlog_fmt; linker script để section này
+ *  INFO nên nó chỉ có trong file ELF, không tốn flash lẫn RAM. Host định
+ *  dạng lại từ ELF:
+ *
+ *      (gdb) dump binary value dlog.bin dlog_buf
+ *      $ Host/build/dlog_dec Debug/Lab3.elf dlog.bin
+ *
+ *  Có __io_putchar (ITM, UART...): dlog_flush ở vòng chính đẩy bản ghi qua
+ *  _write(DLOG_FD) ở dạng nhị phân (dlog_dec -s). Không có: vòng giữ các bản
+ *  ghi mới nhất cho debugger.
+ *  Tham số là số nguyên/con trỏ: %d %i %u %x %X %o %c %p; không có %s, %f.
+ *  Bản build không có DEBUG (hoặc DLOG_ENABLE=0): DLOG thành rỗng.
+ */
+
+#ifndef INC_DLOG_H_
+#define INC_DLOG_H_
+
+#include <stdint.h>
+#include "main.h"
+
+#ifndef DLOG_ENABLE
+#ifdef DEBUG
+#define DLOG_ENABLE 1
+#else
+#define DLOG_ENABLE 0
+#endif
+#endif
+
+#ifndef DLOG_RING_N
+#define DLOG_RING_N		64			// lũy thừa 2; 24 byte mỗi bản ghi
+#endif
+#define DLOG_FD			3			// không lẫn với stdout/stderr nếu _write phân luồng
+#define DLOG_MAGIC		0x474F4C44u	// "DLOG"
+#define DLOG_ARGS_MAX	4
+
+/* hdr: offset chuỗi trong dlog_fmt [23:0], số tham số [31:28] */
+typedef struct {
+	uint32_t hdr;
+	uint32_t ts;		// TIM2, µs
+	uint32_t arg[DLOG_ARGS_MAX];
+} dlog_rec_t;
+
+typedef struct {
+	uint32_t magic;		// DLOG_MAGIC
+	uint32_t n;			// DLOG_RING_N
+	uint32_t head;		// tổng số bản ghi
+	uint32_t sent;		// đã đẩy qua _write tới đây
+	uint32_t dropped;	// bị ghi đè trước khi kịp đẩy
+	dlog_rec_t rec[DLOG_RING_N];
+} dlog_buf_t;
+
+#if DLOG_ENABLE
+
+extern dlog_buf_t dlog_buf;
+
+void dlog_init(void);
+void dlog_emit(const char *fmt, const uint32_t *arg, uint32_t n);
+/* Vòng chính: đẩy bản ghi chưa gửi qua _write; không có __io_putchar thì thôi */
+void dlog_flush(void);
+
+#define DLOG(fmt, ...) do { \
+		static const char dlog_fmt_[] __attribute__((section("dlog_fmt"), used)) = fmt; \
+		const uint32_t dlog_arg_[] = { 0, ##__VA_ARGS__ }; \
+		_Static_assert(sizeof(dlog_arg_) / 4 - 1 <= DLOG_ARGS_MAX, "DLOG: tối đa 4 tham số"); \
+		dlog_emit(dlog_fmt_, dlog_arg_ + 1, sizeof(dlog_arg_) / 4 - 1); \
+	} while(0)
+
+#else
+
+#define dlog_init()			((void)0)
+#define dlog_flush()		((void)0)
+#define DLOG(fmt, ...)		((void)0)
+
+#endif
+
+#endif /* INC_DLOG_H_ */
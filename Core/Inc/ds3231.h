@@ -8,6 +8,7 @@
 #ifndef INC_DS3231_H_
 #define INC_DS3231_H_
 
+#include "main.h"
 #include "utils.h"
 
 #define ADDRESS_SEC			0x00
@@ -17,6 +18,14 @@
 #define ADDRESS_DATE		0x04
 #define ADDRESS_MONTH		0x05
 #define ADDRESS_YEAR		0x06
+#define ADDRESS_CONTROL		0x0E
+#define ADDRESS_STATUS		0x0F
+
+/* Khối thời gian 7 byte, đúng thứ tự thanh ghi 0x00..0x06 (giá trị thập phân) */
+typedef struct {
+	uint8_t sec, min, hour;
+	uint8_t day, date, month, year;
+} ds3231_time_t;
 
 extern uint8_t ds3231_hours;
 extern uint8_t ds3231_min;
@@ -32,4 +41,68 @@ void ds3231_Write(uint8_t address, uint8_t value);
 
 void ds3231_ReadTime();
 
+/* Đọc cả khối thời gian trong một giao dịch I2C */
+HAL_StatusTypeDef ds3231_GetTime(ds3231_time_t *t);
+/* Ghi cả khối thời gian trong một giao dịch I2C rồi đọc lại để kiểm tra */
+HAL_StatusTypeDef ds3231_WriteTime(const ds3231_time_t *t);
+/* Đọc/ghi thô len thanh ghi liên tiếp từ reg (BCD, không kiểm tra) */
+HAL_StatusTypeDef ds3231_ReadRegs(uint8_t reg, uint8_t *buf, uint8_t len);
+HAL_StatusTypeDef ds3231_WriteRegs(uint8_t reg, const uint8_t *buf, uint8_t len);
+
+/* ===== Ngắt INT/SQW (INTCN = 1) =====
+ * Alarm1: báo thức của người dùng. Alarm2: mỗi phút (giây 00), dùng làm mốc
+ * ranh giới giây để bám đồng hồ cục bộ. Cờ A1F/A2F được xoá sau mỗi lần kích. */
+#define DS3231_A1M1			0x01	// bỏ qua giây
+#define DS3231_A1M2			0x02	// bỏ qua phút
+#define DS3231_A1M3			0x04	// bỏ qua giờ
+#define DS3231_A1M4			0x08	// bỏ qua thứ/ngày
+#define DS3231_A1_DY		0x10	// day_date là thứ (1..7) thay vì ngày
+
+#define DS3231_ALARM_DAILY	DS3231_A1M4		// khớp giờ:phút:giây mỗi ngày
+#define DS3231_ALARM_DATE	0x00			// khớp ngày + giờ:phút:giây
+
+typedef struct {
+	uint8_t sec, min, hour;
+	uint8_t day_date;
+	uint8_t mask;		// DS3231_A1Mx | DS3231_A1_DY
+} ds3231_alarm_t;
+
+/* Chế độ ngắt + Alarm2 mỗi phút + EXTI trên RTC_SQW_Pin (cạnh xuống) */
+HAL_StatusTypeDef ds3231_IntInit(void);
+/* Lập trình Alarm1 (0x07..0x0A) và bật/tắt A1IE, bất đồng bộ.
+ * HAL_BUSY: hàng đợi thiếu chỗ cho cả hai lần ghi, không xếp gì */
+HAL_StatusTypeDef ds3231_SetAlarm1(const ds3231_alarm_t *a, uint8_t enable);
+/* Số lần Alarm1 kích kể từ lần gọi trước */
+uint32_t ds3231_TakeAlarm1(void);
+/* Số mốc phút (Alarm2) kể từ lần gọi trước; edge_us nhận thời điểm cạnh INT
+ * gần nhất theo lclock_mono_us() */
+uint32_t ds3231_TakeMinute(uint64_t *edge_us);
+
+/* ===== Driver bất đồng bộ (I2C 400 kHz, IT, không chờ bus) =====
+ * Yêu cầu xếp hàng FIFO, callback gọi trong PendSV (workq) khi xong.
+ * Các hàm chặn ở trên chỉ dùng lúc khởi động, khi hàng đợi rỗng. */
+#define DS3231_XFER_MAX		8
+
+typedef void (*ds3231_cb_t)(HAL_StatusTypeDef status, const uint8_t *data, void *ctx);
+
+HAL_StatusTypeDef ds3231_ReadAsync(uint8_t reg, uint8_t len, ds3231_cb_t cb, void *ctx);
+HAL_StatusTypeDef ds3231_WriteAsync(uint8_t reg, const uint8_t *data, uint8_t len, ds3231_cb_t cb, void *ctx);
+uint8_t ds3231_Busy(void);
+/* 1: giữ hàng đợi, không khởi động giao dịch mới (I2C đang được khởi tạo lại);
+ * 0: thả và chạy tiếp phần đã xếp */
+void ds3231_Hold(uint8_t hold);
+/* Gọi định kỳ từ main loop: gỡ giao dịch treo (bus kẹt, mất ngắt) */
+void ds3231_Service(void);
+
+/* Đọc khối thời gian; kết quả công bố vào snapshot */
+HAL_StatusTypeDef ds3231_RequestTime(void);
+/* Ghi khối thời gian + xoá OSF, rồi đọc lại kiểm tra (kết quả cũng vào snapshot).
+ * HAL_BUSY: hàng đợi thiếu chỗ cho cả ba giao dịch, không xếp gì */
+HAL_StatusTypeDef ds3231_WriteTimeAsync(const ds3231_time_t *t);
+/* Lấy snapshot mới nhất nếu có bản mới kể từ lần gọi trước.
+ * at_us: thời điểm bắt đầu giao dịch đọc (lclock_mono_us) */
+uint8_t ds3231_TakeTime(ds3231_time_t *t, uint64_t *at_us);
+/* Số lần ghi không qua được bước đọc lại kiểm tra */
+extern volatile uint32_t ds3231_verify_errors;
+
 #endif /* INC_DS3231_H_ */
@@ -34,6 +34,17 @@ typedef struct {
 
 extern _lcd_dev lcddev;
 
+#ifdef HOST_SIM
+// Build trên máy tính (Host/): mỗi lần lấy LCD là một lần truy cập bus,
+// mô hình ILI9341 trong Host/sim ghi nhận lệnh/dữ liệu của lần trước đó.
+typedef struct {
+  __IO uint32_t LCD_REG;
+  __IO uint32_t LCD_RAM;
+} LCD_TypeDef;
+
+LCD_TypeDef *sim_lcd_port(void);
+#define LCD             (sim_lcd_port())
+#else
 // Memory-mapped LCD registers via FSMC/FMC
 typedef struct {
   __IO uint16_t LCD_REG;
@@ -44,6 +55,7 @@ typedef struct {
 // Giữ nguyên như project gốc.
 #define LCD_BASE        ((uint32_t)(0x60000000 | 0x000FFFFE))
 #define LCD             ((LCD_TypeDef *) LCD_BASE)
+#endif
 
 // =================== Màu sắc 16-bit RGB565 ===================
 #define WHITE          0xFFFF
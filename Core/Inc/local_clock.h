@@ -0,0 +1,43 @@
+/*
+ * local_clock.h
+ *
+ *  Đồng hồ phần mềm độ phân giải cao (TIM2 1 MHz), bám theo DS3231.
+ *  Đọc giờ chỉ là đọc RAM + thanh ghi TIM2, không cần giao dịch I2C.
+ */
+
+#ifndef INC_LOCAL_CLOCK_H_
+#define INC_LOCAL_CLOCK_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "main.h"
+
+void lclock_init(void);
+
+/* Thời gian đơn điệu từ lúc khởi động (µs), theo dao động HSI */
+uint64_t lclock_mono_us(void);
+
+/* Mốc tham chiếu: giây RTC thứ rtc_sec bắt đầu tại thời điểm mono_us */
+void lclock_discipline(uint32_t rtc_sec, uint64_t mono_us);
+
+bool lclock_synced(void);
+/* Đã có ước lượng tần số (sau mốc đầu tiên cách >= 10 s) */
+bool lclock_rate_valid(void);
+/* RTC vừa bị ghi lại (chuỗi đếm reset): bỏ pha cũ, giữ ước lượng tần số */
+void lclock_invalidate_phase(void);
+
+/* Giờ RTC ước lượng (đơn vị của rtc_sec), đơn điệu, đã bù tần số + pha */
+uint64_t lclock_now_us(void);
+uint64_t lclock_now_ms(void);
+/* Số ms kể từ ranh giới giây RTC gần nhất (0..999) */
+uint16_t lclock_ms_since_second(void);
+/* Thời điểm mono của ranh giới giây RTC kế tiếp; *sec = giây bắt đầu tại đó */
+uint64_t lclock_next_second_mono(uint32_t *sec);
+/* Giờ RTC ước lượng tại một thời điểm mono bất kỳ (vd. thời điểm một cạnh ngắt) */
+uint64_t lclock_to_rtc_us(uint64_t mono_us);
+
+/* Sai số tần số HSI so với DS3231 (ppb) và lỗi pha ở mốc gần nhất (µs) */
+int32_t lclock_rate_ppb(void);
+int32_t lclock_offset_us(void);
+
+#endif /* INC_LOCAL_CLOCK_H_ */
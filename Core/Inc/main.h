@@ -43,6 +43,8 @@ extern "C" {
 /* Exported constants --------------------------------------------------------*/
 /* USER CODE BEGIN EC */
 I2C_HandleTypeDef hi2c1;
+DMA_HandleTypeDef hdma_i2c1_rx;
+DMA_HandleTypeDef hdma_i2c1_tx;
 
 SPI_HandleTypeDef hspi1;
 
@@ -81,6 +83,10 @@ void Error_Handler(void);
 #define BTN_LOAD_Pin GPIO_PIN_3
 #define BTN_LOAD_GPIO_Port GPIOD
 /* USER CODE BEGIN Private defines */
+/* DS3231 INT/SQW (open-drain) -> EXTI */
+#define RTC_SQW_Pin GPIO_PIN_0
+#define RTC_SQW_GPIO_Port GPIOB
+#define RTC_SQW_EXTI_IRQn EXTI0_IRQn
 
 /* USER CODE END Private defines */
 
@@ -0,0 +1,82 @@
+/*
+ * prof.h
+ *
+ *  Đo thời gian bằng DWT->CYCCNT theo vùng có tên, không cấp phát động.
+ *  Mỗi vùng là một biến tĩnh, tự móc vào danh sách ở lần vào đầu tiên:
+ *
+ *      PROF_ZONE(lcd_Fill);              // ngoài hàm, một lần
+ *      ...
+ *      PROF_ENTER(lcd_Fill);
+ *      ...                               // không return giữa chừng
+ *      PROF_EXIT(lcd_Fill);
+ *
+ *  Đơn vị là chu kỳ HCLK tại lúc đo (clock_gov có thể đổi 168/84/16 MHz).
+ *  Bản build không có DEBUG (hoặc PROF_ENABLE=0): mọi macro thành rỗng.
+ */
+
+#ifndef INC_PROF_H_
+#define INC_PROF_H_
+
+#include <stdint.h>
+#include "main.h"
+
+#ifndef PROF_ENABLE
+#ifdef DEBUG
+#define PROF_ENABLE 1
+#else
+#define PROF_ENABLE 0
+#endif
+#endif
+
+typedef struct prof_zone {
+	const char *name;
+	struct prof_zone *next;
+	uint8_t  linked;
+	uint32_t count;
+	uint32_t min;
+	uint32_t max;
+	uint64_t total;
+} prof_zone_t;
+
+/* Bản sao một dòng của bảng (prof_snapshot) */
+typedef struct {
+	const char *name;
+	uint32_t count;
+	uint32_t min;
+	uint32_t max;
+	uint64_t total;
+} prof_stat_t;
+
+#if PROF_ENABLE
+
+void prof_init(void);
+void prof_link(prof_zone_t *z);
+void prof_exit(prof_zone_t *z, uint32_t t0);
+/* Chép tối đa max vùng vào out, trả về số vùng đã chép */
+uint8_t prof_snapshot(prof_stat_t *out, uint8_t max);
+void prof_reset(void);
+/* In bảng theo từng dòng qua put (ITM, UART, semihosting...) */
+void prof_dump(void (*put)(const char *line));
+
+static inline uint32_t prof_enter(prof_zone_t *z){
+	if(!z->linked) prof_link(z);
+	return DWT->CYCCNT;
+}
+
+#define PROF_ZONE(id)	static prof_zone_t prof_zone_##id = { .name = #id, .min = 0xFFFFFFFFu }
+#define PROF_ENTER(id)	uint32_t prof_t0_##id = prof_enter(&prof_zone_##id)
+#define PROF_EXIT(id)	prof_exit(&prof_zone_##id, prof_t0_##id)
+
+#else
+
+#define prof_init()				((void)0)
+#define prof_snapshot(out, max)	((void)(out), (void)(max), (uint8_t)0)
+#define prof_reset()			((void)0)
+#define prof_dump(put)			((void)(put))
+#define PROF_ZONE(id)			struct prof_unused_##id
+#define PROF_ENTER(id)			((void)0)
+#define PROF_EXIT(id)			((void)0)
+
+#endif
+
+#endif /* INC_PROF_H_ */
@@ -0,0 +1,73 @@
+/*
+ * sched.h
+ *
+ *  Bộ lập lịch hợp tác theo ưu tiên cố định (rate-monotonic: chu kỳ ngắn hơn
+ *  -> ưu tiên cao hơn). Mỗi task chạy đến hết; sau mỗi task bộ lập lịch chọn
+ *  lại từ task ưu tiên cao nhất nên việc nhanh không bị việc chậm bỏ đói.
+ *  Task định kỳ được phát hành theo lưới chu kỳ (không trôi), lưới tính từ 0
+ *  nên các chu kỳ bội nhau trùng mốc và chỉ tốn một lần đánh thức. Task sự kiện chỉ
+ *  chạy khi được sched_kick, tối đa một lần mỗi chu kỳ.
+ *  Thời gian đo bằng TIM2 (µs).
+ */
+
+#ifndef INC_SCHED_H_
+#define INC_SCHED_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SCHED_MAX_TASKS		8
+
+/* Histogram thời gian chạy / độ trễ bắt đầu: bin 0 < 64 µs, bin i < 64·2^i µs,
+ * bin cuối là mọi giá trị lớn hơn (>= 16 ms). Đếm bão hoà ở 0xFFFF */
+#define SCHED_HIST_BINS		10
+#define SCHED_HIST_BASE_US	64
+
+typedef void (*task_fn_t)(void);
+
+typedef struct {
+	/* Khai báo */
+	const char *name;
+	task_fn_t  fn;
+	uint32_t   period_us;		// chu kỳ (task sự kiện: khoảng cách tối thiểu)
+	uint32_t   deadline_us;		// hạn tương đối từ lúc phát hành, 0 = bằng chu kỳ
+	uint8_t    prio;			// 0 = cao nhất
+	bool       event;			// true: chỉ chạy khi sched_kick
+
+	/* Trạng thái */
+	uint64_t   release_us;		// lần phát hành (kế tiếp) theo lưới
+	bool       pending;			// task sự kiện đã được kick
+
+	/* Thống kê */
+	uint32_t   runs;
+	uint32_t   misses;			// xong sau hạn
+	uint32_t   skipped;			// lượt phát hành bị bỏ hẳn vì quá tải
+	uint32_t   last_exec_us;
+	uint32_t   max_exec_us;
+	uint64_t   total_exec_us;
+	uint32_t   max_latency_us;	// phát hành -> bắt đầu chạy
+	uint16_t   exec_hist[SCHED_HIST_BINS];
+	uint16_t   latency_hist[SCHED_HIST_BINS];
+} task_t;
+
+void     sched_init(void);
+/* Thêm task (struct do người gọi giữ); false nếu đầy */
+bool     sched_add(task_t *t);
+/* Đổi chu kỳ lúc chạy; lần phát hành kế là mốc kế tiếp trên lưới chu kỳ mới */
+void     sched_set_period(task_t *t, uint32_t period_us);
+/* Đánh dấu task sự kiện cần chạy (gọi từ vòng chính) */
+void     sched_kick(task_t *t);
+
+/* Chạy mọi task đã tới lượt theo ưu tiên, rồi hẹn timer đánh thức
+ * cho lần phát hành sớm nhất. Gọi mỗi lần vòng chính thức dậy. */
+void     sched_run(void);
+
+uint8_t  sched_task_count(void);
+task_t  *sched_task(uint8_t i);
+/* Tổng misses + skipped mọi task: tăng nghĩa là đang quá tải */
+uint32_t sched_overruns(void);
+/* Lượt sched_run dài nhất (µs), tính cả các task chạy liền nhau */
+uint32_t sched_max_busy_us(void);
+void     sched_reset_stats(void);
+
+#endif /* INC_SCHED_H_ */
@@ -10,9 +10,61 @@
 
 #include <stdint.h>
 #include "main.h"
-extern uint16_t flag_timer2;
+extern volatile uint16_t flag_timer2;
+extern volatile uint16_t flag_oneshot;
+extern volatile uint16_t flag_stimer;
+extern volatile uint32_t timer2_missed;   // số nhịp setTimer2 bị gộp mất
 
 void timer_init();
 void setTimer2(uint16_t duration);
 
+/* TIM2 chạy tự do 1 MHz: thời điểm µs 64 bit, không phụ thuộc tick */
+uint64_t timer_now_us(void);
+static inline uint32_t timer_now_us32(void){ return TIM2->CNT; }
+
+/* Đặt flag_oneshot tại thời điểm at_us (trong vòng ~71 phút tới) */
+void    timer_oneshot_at(uint64_t at_us);
+void    timer_oneshot_cancel(void);
+uint8_t timer_oneshot_pending(void);
+
+/* ============ Timer phần mềm (timing wheel, đơn vị 1 ms) ============
+ * Số lượng tuỳ ý: stimer_t do người gọi cấp phát. Giao bằng callback hoặc cờ,
+ * luôn trong ngữ cảnh vòng chính (stimer_process), không phải ISR.
+ * Chỉ gọi start/stop từ vòng chính. */
+typedef struct stimer stimer_t;
+typedef void (*stimer_cb_t)(stimer_t *t, void *ctx);
+
+struct stimer {
+	stimer_t *next, *prev;
+	stimer_t **slot;			// ô đang chứa (để gỡ O(1))
+	uint32_t expires;			// ms tuyệt đối
+	uint32_t period;			// 0 = một lần
+	stimer_cb_t cb;
+	void *ctx;
+	volatile uint8_t *flag;		// dùng khi cb == NULL
+	uint8_t active;
+	uint8_t lvl;				// tầng đang chứa
+};
+
+void     stimer_init(stimer_t *t, stimer_cb_t cb, void *ctx);
+void     stimer_init_flag(stimer_t *t, volatile uint8_t *flag);
+/* Kích sau delay_ms, rồi lặp mỗi period_ms (0 = một lần) */
+void     stimer_start(stimer_t *t, uint32_t delay_ms, uint32_t period_ms);
+void     stimer_stop(stimer_t *t);
+static inline uint8_t stimer_active(const stimer_t *t){ return t->active; }
+uint32_t stimer_now_ms(void);
+/* Chạy các timer đã hết hạn; gọi mỗi lần vòng chính thức dậy */
+void     stimer_process(void);
+
+/* Nạp lại CC1 theo hạn gần nhất (tự gọi khi đổi timer) */
+void     timer_reprogram(void);
+/* Đổi clock (ghi *reg = val) khi xung vào TIM2 thành tim_hz, giữ nhịp 1 MHz */
+void     timer_retime(uint32_t tim_hz, volatile uint32_t *reg, uint32_t val);
+
+/* Vòng chính: ngủ (WFI) đến khi có flag_timer2, flag_oneshot hoặc flag_stimer */
+void     timer_sleep_until_event(void);
+/* Tỉ lệ thời gian ngủ trong cửa sổ 1 s gần nhất (‰) */
+extern volatile uint16_t cpu_idle_permille;
+uint16_t timer_idle_permille(void);
+
 #endif /* INC_SOFTWARE_TIMER_H_ */
@@ -0,0 +1,36 @@
+/*
+ * stack_mon.h
+ *
+ *  Đo mức sâu nhất của stack MSP. Đầu main (trước HAL_Init, chưa có ngắt)
+ *  tô vùng dành riêng _Min_Stack_Size bằng STACK_PAINT; về sau từ thấp nhất
+ *  bị ghi đè chính là mức sâu nhất mà vòng chính cộng các ISR lồng nhau đã
+ *  chạm tới.
+ *
+ *  Con số này chỉ là phần đã xảy ra; trường hợp xấu nhất theo đồ thị gọi
+ *  (.su của -fstack-usage + Lab3.list + mức ưu tiên NVIC) do
+ *  Host/build/stack_est tính, xem Host/tools/stack_est.cfg.
+ */
+
+#ifndef INC_STACK_MON_H_
+#define INC_STACK_MON_H_
+
+#include <stdint.h>
+#include "main.h"
+
+#define STACK_PAINT			0xA5A5A5A5u
+#define STACK_PAINT_MARGIN	64		// chừa dưới MSP lúc tô: khung của chính stack_paint
+
+/* Gọi đầu tiên trong main (USER CODE 1), ngắt chưa bật */
+void     stack_paint(void);
+/* Kích thước vùng dành riêng (_Min_Stack_Size) */
+uint32_t stack_size(void);
+/* Số byte sâu nhất đã dùng kể từ stack_paint, tính từ _estack */
+uint32_t stack_high_water(void);
+/* 1 nếu cả từ cuối vùng dành riêng đã bị ghi: stack đã lấn sang heap/.bss */
+uint8_t  stack_overflowed(void);
+/* Vòng chính: mỗi giây quét lại, ghi DLOG khi mức sâu nhất tăng hoặc tràn */
+void     stack_check(void);
+
+extern uint32_t stack_hwm;		// lần quét gần nhất, cho debugger
+
+#endif /* INC_STACK_MON_H_ */
@@ -0,0 +1,43 @@
+/*
+ * stopwatch.h
+ *
+ *  Bấm giờ và đếm ngược. Mọi mốc start/stop/lap là thời điểm µs của TIM2
+ *  (timer_now_us) do người gọi truyền vào, nên độ phân giải không phụ thuộc
+ *  chu kỳ tick của UI.
+ */
+
+#ifndef INC_STOPWATCH_H_
+#define INC_STOPWATCH_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SW_LAP_MAX			8		// vòng ghi nhớ (ring), vòng cũ hơn bị ghi đè
+#define CD_PRESET_MAX_S		(99u * 60u + 59u)
+
+/* ============ Bấm giờ ============ */
+void     sw_start(uint64_t at_us);
+void     sw_stop(uint64_t at_us);
+void     sw_reset(void);
+void     sw_lap(uint64_t at_us);
+bool     sw_running(void);
+uint64_t sw_elapsed_us(uint64_t now_us);
+
+/* Tổng số vòng đã bấm (có thể lớn hơn SW_LAP_MAX) */
+uint16_t sw_lap_count(void);
+/* Thời gian của vòng thứ n (1..sw_lap_count), 0 nếu đã bị ghi đè */
+uint64_t sw_lap_us(uint16_t n);
+
+/* ============ Đếm ngược ============ */
+void     cd_set_preset(uint32_t sec);
+uint32_t cd_preset(void);
+void     cd_start(uint64_t at_us);
+void     cd_stop(uint64_t at_us);
+void     cd_reset(void);
+bool     cd_running(void);
+bool     cd_at_preset(void);
+uint64_t cd_remaining_us(uint64_t now_us);
+/* true một lần khi vừa về 0 (tự dừng) */
+bool     cd_take_expired(uint64_t now_us);
+
+#endif /* INC_STOPWATCH_H_ */
@@ -0,0 +1,105 @@
+/*
+ * trace.h
+ *
+ *  Vết sự kiện nhị phân: bản ghi cố định 16 byte vào một vòng RAM, không
+ *  cấp phát, gọi được từ ISR:
+ *
+ *      TRACE(TRACE_I2C_START, reg, len);
+ *
+ *  ts là DWT->CYCCNT, đơn vị chu kỳ HCLK lúc ghi. Mỗi lần clock_gov đổi
+ *  clock có bản ghi TRACE_CLK (tần số mới, cũ) để bộ giải mã quy ra µs.
+ *
+ *      (gdb) dump binary value trace.bin trace_buf
+ *      $ Host/build/trace_dec trace.bin
+ *
+ *  TRACE_ITM=1: mỗi bản ghi còn được đẩy ra cổng ITM TRACE_ITM_PORT (4 word)
+ *  khi debugger đã bật ITM/SWO; trace_dec -i đọc luồng đó. Mặc định tắt vì
+ *  SWO nằm trên PB3, chân đang làm SPI1_SCK của thanh ghi dịch nút.
+ *  Bản build không có DEBUG (hoặc TRACE_ENABLE=0): mọi macro thành rỗng.
+ */
+
+#ifndef INC_TRACE_H_
+#define INC_TRACE_H_
+
+#include <stdint.h>
+#include "main.h"
+
+#ifndef TRACE_ENABLE
+#ifdef DEBUG
+#define TRACE_ENABLE 1
+#else
+#define TRACE_ENABLE 0
+#endif
+#endif
+
+#ifndef TRACE_ITM
+#define TRACE_ITM 0
+#endif
+#ifndef TRACE_ITM_PORT
+#define TRACE_ITM_PORT	1			// cổng 0 để cho printf/ITM_SendChar
+#endif
+
+#ifndef TRACE_RING_N
+#define TRACE_RING_N	256			// lũy thừa 2; 4 KB
+#endif
+#define TRACE_MAGIC		0x45435254u	// "TRCE"
+
+typedef enum {
+	TRACE_NONE = 0,
+	TRACE_TASK,			// task bắt đầu: tên (4 ký tự), trễ so với lúc sẵn sàng (µs)
+	TRACE_TASK_END,		// task xong: tên, thời gian chạy (µs)
+	TRACE_I2C_START,	// reg | len << 8 | write << 16, số yêu cầu đang chờ
+	TRACE_I2C_DONE,		// HAL_StatusTypeDef, số thứ tự yêu cầu
+	TRACE_SPI_SCAN,		// chốt 74HC165, bắt đầu đọc SPI
+	TRACE_SPI_DONE,		// word nút vừa nhận
+	TRACE_DRAW_BEGIN,	// mặt nạ vùng bẩn, mode
+	TRACE_DRAW_END,		// mặt nạ vùng bẩn
+	TRACE_MODE,			// mode cũ, mode mới
+	TRACE_CLK,			// HCLK mới, HCLK cũ (Hz)
+	TRACE_ID_N
+} trace_id_t;
+
+typedef struct {
+	uint32_t ts;		// DWT->CYCCNT
+	uint16_t id;		// trace_id_t
+	uint16_t seq;		// 16 bit thấp của số thứ tự: thấy chỗ mất bản ghi
+	uint32_t a0;
+	uint32_t a1;
+} trace_rec_t;
+
+/* Ảnh của cả vòng: một lệnh dump là đủ cho trace_dec */
+typedef struct {
+	uint32_t magic;		// TRACE_MAGIC
+	uint32_t n;			// TRACE_RING_N
+	uint32_t head;		// tổng số bản ghi; mới nhất ở (head - 1) % n
+	uint32_t hz;		// HCLK hiện tại
+	trace_rec_t rec[TRACE_RING_N];
+} trace_buf_t;
+
+/* 4 ký tự đầu của tên, không cần NUL (tên task trong TRACE_TASK) */
+static inline uint32_t trace_tag(const char *s){
+	uint32_t v = 0;
+	for(uint8_t i = 0; i < 4 && s[i]; i++) v |= (uint32_t)(uint8_t)s[i] << (8 * i);
+	return v;
+}
+
+#if TRACE_ENABLE
+
+extern trace_buf_t trace_buf;
+
+void trace_init(void);
+void trace_emit(trace_id_t id, uint32_t a0, uint32_t a1);
+/* Sau khi đổi clock (SystemCoreClock đã cập nhật) */
+void trace_clock(uint32_t old_hz);
+
+#define TRACE(id, a0, a1)	trace_emit((id), (uint32_t)(a0), (uint32_t)(a1))
+
+#else
+
+#define trace_init()		((void)0)
+#define trace_clock(old)	((void)(old))
+#define TRACE(id, a0, a1)	((void)sizeof(a0), (void)sizeof(a1))	// không tính, chỉ để biến không bị báo thừa
+
+#endif
+
+#endif /* INC_TRACE_H_ */
@@ -0,0 +1,36 @@
+/*
+ * tz.h
+ *
+ *  Múi giờ + giờ mùa hè. DS3231 giữ UTC, giờ hiển thị = UTC + offset.
+ *  Quy tắc theo chuỗi TZ kiểu POSIX, ví dụ:
+ *    "ICT-7"                              (UTC+7, không DST)
+ *    "CET-1CEST,M3.5.0,M10.5.0/3"         (châu Âu)
+ *    "EST5EDT,M3.2.0,M11.1.0"             (Mỹ)
+ *  Chỉ hỗ trợ dạng ngày Mm.w.d. Các lần chuyển của vài năm quanh thời điểm
+ *  hiện tại được tính sẵn thành bảng đã sắp xếp; đổi giờ mỗi tick chỉ là
+ *  so với khoảng hiệu lực của offset hiện tại.
+ */
+
+#ifndef INC_TZ_H_
+#define INC_TZ_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TZ_YEARS			4			// số năm tính sẵn mỗi lần
+#define TZ_DEFAULT			"ICT-7"
+
+/* Nạp quy tắc mới; false nếu chuỗi sai (giữ quy tắc cũ) */
+bool     tz_set(const char *posix);
+
+/* Giây UTC -> giây giờ địa phương (cùng trục 2000-01-01) */
+uint32_t tz_to_local(uint32_t utc);
+/* Ngược lại; giờ bị bỏ qua/lặp lúc chuyển lấy theo offset trước khi chuyển */
+uint32_t tz_to_utc(uint32_t local);
+
+int32_t  tz_offset(void);				// offset đang áp dụng (giây, dương = phía đông)
+bool     tz_is_dst(void);
+/* Lần chuyển kế tiếp (UTC), 0xFFFFFFFF nếu không có DST */
+uint32_t tz_next_change(void);
+
+#endif /* INC_TZ_H_ */
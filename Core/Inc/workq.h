@@ -0,0 +1,33 @@
+/*
+ * workq.h
+ *
+ *  Hàng đợi việc hoãn (bottom half) cho ngắt. ISR chỉ làm phần gấp (chốt
+ *  dữ liệu, đóng dấu thời gian) rồi workq_post() phần xử lý nặng hơn;
+ *  PendSV ở ưu tiên thấp nhất rút hàng đợi ngay khi không còn ngắt nào
+ *  đang chạy, không đợi vòng chính.
+ *  Nhiều ISR (mọi mức ưu tiên) cùng post được, không khoá ngắt: giữ chỗ
+ *  bằng LDREX/STREX, mỗi ô có số thứ tự để PendSV biết ô đã ghi xong.
+ *  Hàm việc chạy trong PendSV: ngắn, không chờ bận, không gọi hàm chặn.
+ */
+
+#ifndef INC_WORKQ_H_
+#define INC_WORKQ_H_
+
+#include <stdint.h>
+#include "main.h"
+
+#define WORKQ_LEN		16		// luỹ thừa của 2
+
+typedef void (*work_fn_t)(uint32_t arg);
+
+/* PendSV được đặt ưu tiên 15 (thấp nhất) trong HAL_MspInit */
+void workq_init(void);
+/* Gọi được từ ISR hoặc vòng chính. HAL_BUSY khi đầy (việc bị bỏ, có đếm) */
+HAL_StatusTypeDef workq_post(work_fn_t fn, uint32_t arg);
+/* Gọi từ PendSV_Handler */
+void workq_run(void);
+
+extern volatile uint32_t workq_dropped;		// số việc bỏ do đầy
+extern volatile uint8_t  workq_max_depth;	// độ sâu lớn nhất từng thấy
+
+#endif /* INC_WORKQ_H_ */
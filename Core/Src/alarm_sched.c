@@ -0,0 +1,160 @@
+/*
+ * alarm_sched.c
+ *
+ *  Min-heap theo thời điểm kích kế tiếp; pos[] cho phép sửa/xoá giữa heap.
+ */
+#include "alarm_sched.h"
+#include "calendar.h"
+
+#define SEC_PER_DAY			CAL_SEC_PER_DAY
+
+typedef struct {
+	alarm_rule_t rule;
+	uint32_t next;
+	uint8_t  used;
+	uint8_t  enabled;
+} alarm_slot_t;
+
+static alarm_slot_t slots[ALARM_MAX];
+static uint8_t heap[ALARM_MAX];			// id, sắp theo slots[id].next
+static uint8_t pos[ALARM_MAX];			// vị trí của id trong heap
+static uint8_t heap_len = 0;
+
+#define NO_POS				0xFF
+
+/* ============ Tính lần kích kế tiếp (> now) ============ */
+static uint8_t weekday_of(uint32_t day){
+	return (uint8_t)(cal_weekday_of_days(day) - 1u);		// 0 = Chủ nhật
+}
+
+static uint32_t next_fire(const alarm_rule_t *r, uint32_t now){
+	uint32_t day = now / SEC_PER_DAY;
+	uint32_t cand;
+	switch(r->kind){
+	case ALARM_ONESHOT:
+		return (r->at > now) ? r->at : ALARM_NONE;
+	case ALARM_DAILY:
+		cand = day * SEC_PER_DAY + r->at;
+		return (cand > now) ? cand : cand + SEC_PER_DAY;
+	case ALARM_WEEKLY:
+		if(!(r->days & 0x7F)) return ALARM_NONE;
+		for(uint8_t i = 0; i <= 7; i++){
+			cand = (day + i) * SEC_PER_DAY + r->at;
+			if(cand > now && (r->days & (1u << weekday_of(day + i)))) return cand;
+		}
+		return ALARM_NONE;
+	case ALARM_EVERY_N_MIN: {
+		uint32_t p = (uint32_t)r->period_min * 60u;
+		if(p == 0) return ALARM_NONE;
+		if(r->at > now) return r->at;
+		return r->at + ((now - r->at) / p + 1u) * p;
+	}
+	default:
+		return ALARM_NONE;
+	}
+}
+
+/* ============ Heap ============ */
+static void heap_swap(uint8_t a, uint8_t b){
+	uint8_t t = heap[a];
+	heap[a] = heap[b];
+	heap[b] = t;
+	pos[heap[a]] = a;
+	pos[heap[b]] = b;
+}
+
+static void sift_up(uint8_t i){
+	while(i > 0){
+		uint8_t p = (uint8_t)((i - 1) / 2);
+		if(slots[heap[p]].next <= slots[heap[i]].next) break;
+		heap_swap(i, p);
+		i = p;
+	}
+}
+
+static void sift_down(uint8_t i){
+	for(;;){
+		uint8_t l = (uint8_t)(2 * i + 1), r = (uint8_t)(l + 1), m = i;
+		if(l < heap_len && slots[heap[l]].next < slots[heap[m]].next) m = l;
+		if(r < heap_len && slots[heap[r]].next < slots[heap[m]].next) m = r;
+		if(m == i) break;
+		heap_swap(i, m);
+		i = m;
+	}
+}
+
+static void heap_remove(uint8_t id){
+	uint8_t i = pos[id];
+	if(i == NO_POS) return;
+	pos[id] = NO_POS;
+	heap_len--;
+	if(i == heap_len) return;
+	heap[i] = heap[heap_len];
+	pos[heap[i]] = i;
+	sift_up(i);
+	sift_down(pos[heap[i]]);
+}
+
+/* Đặt lại hạn của id và vị trí trong heap; báo thức tắt/hết hạn thì rời heap */
+static void schedule(uint8_t id, uint32_t now){
+	alarm_slot_t *s = &slots[id];
+	heap_remove(id);
+	s->next = (s->used && s->enabled) ? next_fire(&s->rule, now) : ALARM_NONE;
+	if(s->next == ALARM_NONE) return;
+	heap[heap_len] = id;
+	pos[id] = heap_len;
+	sift_up(heap_len++);
+}
+
+/* ============ API ============ */
+void alarm_init(void){
+	for(uint8_t i = 0; i < ALARM_MAX; i++){
+		slots[i].used = 0;
+		pos[i] = NO_POS;
+	}
+	heap_len = 0;
+}
+
+int alarm_add(const alarm_rule_t *r, bool enabled, uint32_t now){
+	for(uint8_t i = 0; i < ALARM_MAX; i++){
+		if(!slots[i].used){
+			slots[i].used = 1;
+			alarm_update(i, r, enabled, now);
+			return i;
+		}
+	}
+	return -1;
+}
+
+void alarm_update(int id, const alarm_rule_t *r, bool enabled, uint32_t now){
+	if(id < 0 || id >= ALARM_MAX || !slots[id].used) return;
+	slots[id].rule = *r;
+	slots[id].enabled = enabled;
+	schedule((uint8_t)id, now);
+}
+
+void alarm_remove(int id){
+	if(id < 0 || id >= ALARM_MAX) return;
+	heap_remove((uint8_t)id);
+	slots[id].used = 0;
+}
+
+void alarm_reschedule_all(uint32_t now){
+	for(uint8_t i = 0; i < ALARM_MAX; i++){
+		if(slots[i].used) schedule(i, now);
+	}
+}
+
+uint32_t alarm_next_deadline(void){
+	return heap_len ? slots[heap[0]].next : ALARM_NONE;
+}
+
+int alarm_take_due(uint32_t now){
+	uint8_t id;
+	if(heap_len == 0 || slots[heap[0]].next > now) return -1;
+	id = heap[0];
+	if(slots[id].rule.kind == ALARM_ONESHOT) slots[id].enabled = 0;
+	/* Lỡ nhiều lần (giờ nhảy tới) chỉ kích một lần rồi xếp sau now */
+	schedule(id, now);
+	return id;
+}
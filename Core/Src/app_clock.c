@@ -2,6 +2,15 @@
 #include <stdbool.h>
 #include "app_clock.h"
 #include "ds3231.h"
+#include "calendar.h"
+#include "local_clock.h"
+#include "alarm_sched.h"
+#include "tz.h"
+#include "stopwatch.h"
+#include "sched.h"
+#include "clock_gov.h"
+#include "prof.h"
+#include "trace.h"
 #include "lcd.h"
 #include "button.h"
 #include "software_timer.h"
@@ -19,25 +28,42 @@
 #define BTN_OK_IDX     2
 #endif
 
-/* Chu kỳ tick (ms) — khớp setTimer2(...) của bạn, mặc định 50 ms */
-#define APP_TICK_MS            50
+/* Chu kỳ các task (µs) — ưu tiên theo rate-monotonic: chu kỳ ngắn hơn chạy trước */
+#define INPUT_PERIOD_US        10000    // quét nút 100 Hz, trùng mốc với logic (bội chu kỳ)
+#define LOGIC_PERIOD_US        20000    // xử lý nút / mode / báo thức 50 Hz
+#define UI_FRAME_CAP_HZ        30       // vẽ tối đa 30 khung/s, chỉ khi có thay đổi
+#define UI_PERIOD_US           (1000000u / UI_FRAME_CAP_HZ)
+#define RTC_PERIOD_US          1000000  // đồng bộ DS3231 1 Hz khi đã bám mốc
+#define RTC_POLL_PERIOD_US     50000    // chưa bám mốc: đọc I2C dày để bắt cạnh giây
 
 /* Tham số hành vi theo đề bài */
 #define BLINK_PERIOD_MS        500   // 2 Hz
 #define HOLD_THRESHOLD_MS      2000  // giữ 2 s
 #define REPEAT_STEP_MS         200   // lặp 200 ms
+#define ALARM_EFFECT_MS        3000  // nháy 3 s
+#define ALARM_ANIM_MS          250   // đảo màu hiệu ứng báo thức 4 lần/s
 
-/* ============ button.c dữ liệu ============ */
-extern uint16_t button_count[16];
+/* Giờ cục bộ bám mốc phút (Alarm2 của DS3231), chỉ đọc DS3231 khi cần */
+#define MINUTE_TIMEOUT_MS      65000 // quá lâu không có mốc phút -> quay về đọc I2C mỗi tick
+
+/* Alarm1 so khớp ngày-giờ-phút-giây: chỉ nạp hạn trong vòng 27 ngày
+ * (xa hơn thì ngày trong tháng có thể khớp sớm), còn lại tự so mỗi tick */
+#define HW_ALARM_WINDOW_S      (27u * 86400u)
 
-static inline bool btn_pressed_now(int idx)   { return button_count[idx] > 0; }
-static inline bool btn_pressed_edge(int idx)  { return button_count[idx] == 1; }
+/* DS3231 giữ UTC; giờ hiển thị/báo thức theo quy tắc múi giờ này */
+#ifndef APP_TZ
+#define APP_TZ                 TZ_DEFAULT
+#endif
+
+/* ============ button.c dữ liệu ============ */
+static inline bool btn_pressed_now(int idx)   { return (button_down >> idx) & 1u; }
+/* Cạnh nhấn được button.c chốt lại giữa hai lần chạy task logic */
+static inline bool btn_edge(uint16_t edges, int idx) { return (edges >> idx) & 1u; }
+/* Mốc bấm nút lấy lúc quét đầu tiên thấy nhấn (TIM2 µs), không phải lúc app xử lý */
+static inline uint64_t btn_event_us(int idx)  { return button_press_us[idx]; }
 
 /* ============ Kiểu dữ liệu ============ */
-typedef struct {
-  uint8_t sec, min, hour;
-  uint8_t day, date, month, year;
-} datetime_t;
+typedef ds3231_time_t datetime_t;   // cùng bố cục với khối thanh ghi 0x00..0x06
 
 typedef struct {
   uint8_t hour, min, sec;
@@ -51,15 +77,60 @@ static field_t    editing_field = FIELD_HOUR;
 static datetime_t cur, edit;
 static alarm_t    alarm1 = { .hour=7, .min=0, .sec=0, .enabled=false };
 
-static uint16_t blink_acc_ms = 0;
-static bool     blink_on = true;
+/* Các chu kỳ giao cho timing wheel (software_timer), không cộng dồn theo tick */
+static stimer_t blink_timer;       // 2 Hz, tuần hoàn
+static stimer_t up_repeat_timer;   // giữ UP: trễ 2 s rồi lặp 200 ms
+static stimer_t alarm_timer;       // thời gian nháy báo thức
+static stimer_t alarm_anim_timer;  // nhịp đảo màu, độc lập với task logic
+static stimer_t minute_watchdog;   // hết hạn = mất mốc phút
 
-static uint16_t up_hold_ms = 0;
-static uint16_t up_repeat_acc_ms = 0;
+static bool     blink_on = true;
 static bool     up_was_pressed_last = false;
-
 static bool     alarm_active = false;
-static uint16_t alarm_remain_ms = 0;
+static bool     alarm_inv = false;
+
+static task_t   input_task, logic_task, ui_task, rtc_task;
+static void logic_task_fn(void);
+static void rtc_task_fn(void);
+static void ui_task_fn(void);
+static void fire_due_alarms(void);
+
+/* Vùng màn hình cần vẽ lại; task vẽ chỉ chạy khi có ít nhất một bit */
+#define UI_DIRTY_STATUS  0x01
+#define UI_DIRTY_TIME    0x02
+#define UI_DIRTY_DATE    0x04
+#define UI_DIRTY_SW      0x08
+#define UI_DIRTY_ALARM   0x10
+#define UI_DIRTY_ALL     0x1F
+static uint8_t  ui_dirty = 0;
+
+PROF_ZONE(task_logic);
+PROF_ZONE(task_ui);
+PROF_ZONE(task_rtc);
+
+static inline void ui_invalidate(uint8_t what){
+  ui_dirty |= what;
+  sched_kick(&ui_task);
+}
+
+/* alarm1 là báo thức hằng ngày chỉnh từ menu, một mục trong alarm_sched */
+static int      alarm_ui_id = -1;
+static uint32_t hw_deadline = ALARM_NONE;   // hạn đang nạp trong Alarm1
+static bool     hw_armed = false;
+
+
+/* Vùng bấm giờ chỉ vẽ lại cặp số đổi giá trị */
+static app_mode_t drawn_mode = MODE_VIEW;
+static uint8_t    sw_shown[3];            // phút, giây, phần trăm giây
+static uint16_t   sw_shown_laps;
+
+/* cur_sec = giây UTC từ 2000-01-01 00:00:00 (trục thời gian của lclock),
+ * loc_sec = cùng thời điểm theo giờ địa phương; cur là loc_sec dạng trường */
+static uint32_t cur_sec = 0;
+static uint32_t loc_sec = 0;
+static uint64_t poll_last_us = 0;
+static uint8_t  poll_sec = 0;
+static uint64_t write_at_us = 0;   // mốc/đọc trước lần ghi giờ gần nhất thuộc giờ cũ
 
 /* ============ Helper ============ */
 static inline void wrap_inc(uint8_t *v, uint8_t min, uint8_t max){
@@ -68,52 +139,141 @@ static inline void wrap_inc(uint8_t *v, uint8_t min, uint8_t max){
   *v = nv;
 }
 
-/* ============ DS3231 glue ============ */
-extern uint8_t ds3231_hours;
-extern uint8_t ds3231_min;
-extern uint8_t ds3231_sec;
-extern uint8_t ds3231_date;
-extern uint8_t ds3231_day;
-extern uint8_t ds3231_month;
-extern uint8_t ds3231_year;
-
 /* ============ Lab 4 (start) ============ */
 static void read_ds3231_into_cur(void){
-  ds3231_ReadTime();
-  cur.hour  = ds3231_hours;
-  cur.min   = ds3231_min;
-  cur.sec   = ds3231_sec;
-  cur.day   = ds3231_day;
-  cur.date  = ds3231_date;
-  cur.month = ds3231_month;
-  cur.year  = ds3231_year;
+  datetime_t t;
+  if(ds3231_GetTime(&t) == HAL_OK) cur = t;   // lỗi bus thì giữ giá trị cũ
 }
 /* ============ Lab 4 (end) ============ */
 
-static void snapshot_from_cur(void){ edit = cur; }
+/* ============ Giờ cục bộ ============ */
+static void refresh_local(void){
+  uint32_t prev = loc_sec;
+  loc_sec = tz_to_local(cur_sec);   // thường chỉ là một phép so khoảng
+  if(mode == MODE_SET_TIME) return; // màn hình hiện bản edit; giờ thật vẫn chạy cho báo thức
+  cal_from_sec(loc_sec, &cur);
+  if(loc_sec == prev) return;       // đọc lại cùng giây: không vẽ
+  ui_invalidate(UI_DIRTY_TIME);
+  if(loc_sec / CAL_SEC_PER_DAY != prev / CAL_SEC_PER_DAY) ui_invalidate(UI_DIRTY_DATE);
+  if(mode == MODE_VIEW) ui_invalidate(UI_DIRTY_STATUS);   // % IDLE cập nhật mỗi giây
+}
+
+static void flip_to(uint32_t s){
+  if((int32_t)(s - cur_sec) > 0){
+    cur_sec = s;
+    refresh_local();
+  }
+}
+
+/* t theo UTC (bố cục thanh ghi DS3231) */
+static void set_cur(const datetime_t *t){
+  cur_sec = cal_to_sec(t);
+  refresh_local();
+}
+
+/* Đọc mỗi tick khi chưa bám được mốc (khởi động, vừa ghi giờ, chưa đo tần số)
+ * hoặc mất ngắt INT */
+static bool need_polling(void){
+  return !lclock_synced() || !lclock_rate_valid() || !stimer_active(&minute_watchdog);
+}
+
+/* Áp snapshot mới nhất từ driver (nếu có) */
+static void consume_ds3231(void){
+  datetime_t t;
+  uint64_t at_us;
+  if(!ds3231_TakeTime(&t, &at_us)) return;
+  if(at_us < write_at_us) return;   // snapshot xếp trước lần ghi: kéo giờ về cũ, sai mốc dò
+
+  /* Giây đổi giữa hai lần đọc liên tiếp: lấy điểm giữa làm mốc ranh giới */
+  if(need_polling()){
+    if(poll_last_us && t.sec != poll_sec){
+      lclock_discipline(cal_to_sec(&t), (poll_last_us + at_us) / 2);
+    }
+    poll_last_us = at_us;
+    poll_sec = t.sec;
+  } else if((uint32_t)(cur_sec - cal_to_sec(&t)) <= 2u){
+    /* Đã bám mốc: snapshot sau mốc phút được dùng ở lượt rtc kế, có thể
+     * cũ gần 1 s so với giây CC2 vừa lật -> không kéo giờ lùi */
+    return;
+  }
+  set_cur(&t);
+}
+
+/* Cạnh Alarm2 đúng lúc giây về 00: làm tròn ước lượng về phút gần nhất */
+static void on_minute_edge(uint64_t edge_us){
+  uint32_t s = lclock_synced() ? (uint32_t)((lclock_to_rtc_us(edge_us) + 500000u) / 1000000u)
+                               : cur_sec;
+  lclock_discipline(((s + 30u) / 60u) * 60u, edge_us);
+}
+
+static void update_cur_time(void){
+  uint64_t edge_us;
+  uint32_t minutes = ds3231_TakeMinute(&edge_us);
+
+  consume_ds3231();
+  if(minutes){
+    stimer_start(&minute_watchdog, MINUTE_TIMEOUT_MS, 0);
+    if(edge_us >= write_at_us) on_minute_edge(edge_us);   // mốc trước lần ghi thuộc pha cũ
+    ds3231_RequestTime();   // kiểm tra toàn bộ thanh ghi, ngay sau mốc phút
+  }
+
+  if(need_polling()){
+    if(!ds3231_Busy()) ds3231_RequestTime();   // kết quả dùng ở tick sau
+    return;
+  }
+  poll_last_us = 0;
+
+  /* Lật giây theo đồng hồ cục bộ (đã bám DS3231), không cần I2C */
+  flip_to((uint32_t)(lclock_now_ms() / 1000u));
+}
+
+/* Hẹn TIM2 CC2 đúng ranh giới giây kế tiếp -> lật giây trong vòng 1 ms */
+static void arm_second_boundary(void){
+  if(need_polling() || timer_oneshot_pending()) return;
+  timer_oneshot_at(lclock_next_second_mono(NULL));
+}
+
+static void snapshot_from_cur(void){
+  edit = cur;
+  cal_normalize(&edit);   // thanh ghi cũ có thể mang thứ/ngày sai
+}
 
 static void commit_edit_to_ds3231(void){
-  ds3231_Write(ADDRESS_YEAR , edit.year);
-  ds3231_Write(ADDRESS_MONTH, edit.month);
-  ds3231_Write(ADDRESS_DATE , edit.date);
-  ds3231_Write(ADDRESS_DAY  , edit.day);
-  ds3231_Write(ADDRESS_HOUR , edit.hour);
-  ds3231_Write(ADDRESS_MIN  , edit.min);
-  ds3231_Write(ADDRESS_SEC  , edit.sec);
+  datetime_t utc;
+  /* Hạn đã tới theo giờ cũ (cả lúc đang chỉnh) kêu trước khi lịch tính lại theo giờ mới */
+  fire_due_alarms();
+  /* edit là giờ địa phương, DS3231 nhận UTC.
+   * Burst 7 byte + xoá cờ + đọc lại kiểm tra, tất cả xếp hàng I2C;
+   * bản đọc lại được công bố như snapshot nên cur tự cập nhật */
+  cal_from_sec(tz_to_utc(cal_to_sec(&edit)), &utc);
+  write_at_us = lclock_mono_us();
+  ds3231_WriteTimeAsync(&utc);
+  set_cur(&utc);
+  lclock_invalidate_phase();   // ghi giây reset chuỗi đếm: pha cũ hết hiệu lực
+  poll_last_us = 0;
+  alarm_reschedule_all(loc_sec);
 }
 
 /* ============ Tăng trường ============ */
+/* Ngày kẹp theo tháng/năm, thứ luôn suy ra từ ngày -> không ghi ngày sai */
 static void increment_field(field_t f){
   switch(f){
     case FIELD_SEC:   wrap_inc(&edit.sec  , 0, 59); break;
     case FIELD_MIN:   wrap_inc(&edit.min  , 0, 59); break;
     case FIELD_HOUR:  wrap_inc(&edit.hour , 0, 23); break;
-    case FIELD_DAY:   wrap_inc(&edit.day  , 1, 7 ); break;
-    case FIELD_DATE:  wrap_inc(&edit.date , 1, 31); break; // đơn giản
+    case FIELD_DATE:  wrap_inc(&edit.date , 1, cal_days_in_month(edit.month, edit.year)); break;
     case FIELD_MONTH: wrap_inc(&edit.month, 1, 12); break;
     case FIELD_YEAR:  wrap_inc(&edit.year , 0, 99); break;
     default: break;
   }
+  cal_normalize(&edit);
+}
+
+/* FIELD_DAY chỉ hiển thị, bỏ qua khi chuyển trường */
+static field_t next_edit_field(field_t f){
+  f = (field_t)((f + 1) % FIELD_COUNT);
+  if(f == FIELD_DAY) f = (field_t)(f + 1);
+  return f;
 }
 
 /* ============ Vẽ LCD (dùng lcd_ShowStr của bạn) ============ */
@@ -129,15 +289,80 @@ static void draw_status_bar(void){
   lcd_Fill(0,0,240,20,BLACK);
   if(mode == MODE_VIEW){
     lcd_ShowStr(4,2,(uint8_t*)"MODE: VIEW", WHITE, BLACK, 16, 0);
+    /* Quá tải: số lượt task trễ hạn / bị bỏ (chi tiết xem histogram trong task_t) */
+    uint32_t ovr = sched_overruns();
+    if(ovr) lcd_ShowIntNum(96,2,(uint16_t)(ovr > 999u ? 999u : ovr),3, RED, BLACK, 16);
+    /* Phần trăm thời gian CPU ngủ (WFI) trong 1 s gần nhất */
+    lcd_ShowStr(150,2,(uint8_t*)"IDLE", GRAY, BLACK, 16, 0);
+    lcd_ShowIntNum(186,2,(uint16_t)(timer_idle_permille() / 10u),3, GRAY, BLACK, 16);
+    lcd_ShowStr(210,2,(uint8_t*)"%", GRAY, BLACK, 16, 0);
   } else if(mode == MODE_SET_TIME){
     lcd_ShowStr(4,2,(uint8_t*)"MODE: SET", WHITE, BLACK, 16, 0);
-  } else {
+  } else if(mode == MODE_ALARM){
     lcd_ShowStr(4,2,(uint8_t*)"MODE: ALARM", WHITE, BLACK, 16, 0);
     lcd_ShowStr(140,2,(uint8_t*)(alarm1.enabled?"ON":"OFF"),
                 alarm1.enabled?GREEN:RED, BLACK, 16, 0);
+  } else if(mode == MODE_STOPWATCH){
+    lcd_ShowStr(4,2,(uint8_t*)"MODE: STOPWATCH", WHITE, BLACK, 16, 0);
+  } else {
+    lcd_ShowStr(4,2,(uint8_t*)"MODE: TIMER", WHITE, BLACK, 16, 0);
+  }
+}
+
+/* ============ Vẽ bấm giờ ============ */
+static void put2(char *p, uint32_t v){
+  p[0] = (char)('0' + v / 10 % 10);
+  p[1] = (char)('0' + v % 10);
+}
+
+/* mm:ss.cc từ số phần trăm giây */
+static void fmt_cs(char *p, uint32_t cs){
+  put2(p, cs / 6000u % 100u); p[2] = ':';
+  put2(p + 3, cs / 100u % 60u); p[5] = '.';
+  put2(p + 6, cs % 100u); p[8] = 0;
+}
+
+static void draw_pair(int x, int y, uint8_t v, uint8_t *shown){
+  char s[3];
+  if(*shown == v) return;
+  *shown = v;
+  put2(s, v); s[2] = 0;
+  lcd_ShowStr(x, y, (uint8_t*)s, GREEN, BLACK, 24, 0);
+}
+
+static void draw_sw_invalidate(void){
+  sw_shown[0] = sw_shown[1] = sw_shown[2] = 0xFF;
+  sw_shown_laps = 0xFFFF;
+  lcd_Fill(0,90,240,175,BLACK);
+  lcd_ShowStr(84 ,100,(uint8_t*)":", GREEN, BLACK, 24, 0);
+  lcd_ShowStr(120,100,(uint8_t*)".", GREEN, BLACK, 24, 0);
+}
+
+static void draw_laps(void){
+  uint16_t n = sw_lap_count();
+  char line[16] = "L00 ";
+  if(n == sw_shown_laps) return;
+  sw_shown_laps = n;
+  lcd_Fill(0,130,240,175,BLACK);
+  /* Hai vòng gần nhất */
+  for(uint8_t i = 0; i < 2 && i < n; i++){
+    put2(line + 1, n - i);
+    fmt_cs(line + 4, (uint32_t)(sw_lap_us(n - i) / 10000u));
+    lcd_ShowStr(60, 135 + i * 20, (uint8_t*)line, i ? GRAY : WHITE, BLACK, 16, 0);
   }
 }
 
+static void draw_sw_area(void){
+  uint64_t now = timer_now_us();
+  uint32_t cs;
+  if(mode == MODE_STOPWATCH) cs = (uint32_t)(sw_elapsed_us(now) / 10000u);
+  else cs = (uint32_t)((cd_remaining_us(now) + 9999u) / 10000u);   // làm tròn lên, về 00 đúng lúc hết
+  draw_pair(60 ,100, (uint8_t)(cs / 6000u % 100u), &sw_shown[0]);
+  draw_pair(96 ,100, (uint8_t)(cs / 100u % 60u),   &sw_shown[1]);
+  draw_pair(132,100, (uint8_t)(cs % 100u),         &sw_shown[2]);
+  if(mode == MODE_STOPWATCH) draw_laps();
+}
+
 static void draw_time_area(const datetime_t *dt){
   draw2(70 ,100, dt->hour,  (mode==MODE_SET_TIME && editing_field==FIELD_HOUR) ||
                            (mode==MODE_ALARM   && editing_field==FIELD_HOUR));
@@ -164,83 +389,178 @@ static void draw_date_area(const datetime_t *dt){
 }
 
 static void draw_alarm_effect(void){
-  if(!alarm_active) return;
-  static bool inv = false;
-  inv = !inv;
-  lcd_Fill(0,180,240,220, inv ? YELLOW : BLACK);
-  lcd_ShowStr(70,190,(uint8_t*)"ALARM!", inv?BLACK:YELLOW, inv?YELLOW:BLACK, 24, 0);
+  if(!alarm_active){
+    lcd_Fill(0,180,240,220,BLACK);   // vừa tắt: xoá một lần
+    return;
+  }
+  lcd_Fill(0,180,240,220, alarm_inv ? YELLOW : BLACK);
+  lcd_ShowStr(70,190,(uint8_t*)"ALARM!", alarm_inv?BLACK:YELLOW, alarm_inv?YELLOW:BLACK, 24, 0);
 }
 
 /* ============ Alarm ============ */
+/* Alarm1 của DS3231 nạp hạn gần nhất của bộ lập lịch, kích qua INT
+ * -> không lỡ giây nào; mỗi tick chỉ so một giá trị.
+ * Bộ lập lịch chạy theo giờ địa phương, Alarm1 so với thanh ghi UTC */
+static void alarm1_apply(void){
+  alarm_rule_t r = { .at = (uint32_t)alarm1.hour * 3600u + alarm1.min * 60u + alarm1.sec,
+                     .kind = ALARM_DAILY };
+  if(alarm_ui_id < 0) alarm_ui_id = alarm_add(&r, alarm1.enabled, loc_sec);
+  else alarm_update(alarm_ui_id, &r, alarm1.enabled, loc_sec);
+}
+
+static void start_alarm_effect(void){
+  alarm_active = true;
+  alarm_inv = true;
+  stimer_start(&alarm_timer, ALARM_EFFECT_MS, 0);
+  stimer_start(&alarm_anim_timer, ALARM_ANIM_MS, ALARM_ANIM_MS);
+  ui_invalidate(UI_DIRTY_ALARM);
+}
+
+static void hw_alarm_sync(void){
+  uint32_t d = alarm_next_deadline();
+  bool arm = (d != ALARM_NONE) && (d - loc_sec <= HW_ALARM_WINDOW_S);
+  if(d == hw_deadline && arm == hw_armed) return;
+
+  datetime_t t;
+  ds3231_alarm_t a = { .day_date = 1, .mask = DS3231_ALARM_DATE };
+  if(arm){
+    cal_from_sec(tz_to_utc(d), &t);
+    a.sec = t.sec; a.min = t.min; a.hour = t.hour; a.day_date = t.date;
+  }
+  if(ds3231_SetAlarm1(&a, arm) != HAL_OK) return;   // hàng đợi đầy: thử lại tick sau
+  hw_deadline = d;
+  hw_armed = arm;
+}
+
+static void fire_due_alarms(void){
+  uint32_t now = loc_sec;
+  bool fired = false;
+
+  /* Phần cứng đã khớp đúng hạn: tin nó dù giờ cục bộ còn trễ một tick */
+  if(ds3231_TakeAlarm1() && hw_armed && (int32_t)(hw_deadline - now) > 0 && hw_deadline - now <= 2u){
+    now = hw_deadline;
+  }
+  while(alarm_take_due(now) >= 0) fired = true;
+  if(fired) start_alarm_effect();
+}
+
 static void maybe_trigger_alarm(void){
-  if(!alarm1.enabled) return;
-  if(cur.hour==alarm1.hour && cur.min==alarm1.min && cur.sec==alarm1.sec){
-    alarm_active = true;
-    alarm_remain_ms = 3000; // nháy 3s
+  fire_due_alarms();
+  hw_alarm_sync();
+}
+
+/* ============ Đếm ngược ============ */
+/* +1 phút, quay vòng 1..99 phút */
+static void cd_step_preset(void){
+  cd_set_preset((cd_preset() / 60u % 99u + 1u) * 60u);
+}
+
+/* ============ Timer callback (chạy trong stimer_process, vòng chính) ============ */
+static void on_blink(stimer_t *t, void *ctx){
+  (void)t; (void)ctx;
+  blink_on = !blink_on;
+  if(mode == MODE_SET_TIME || mode == MODE_ALARM) ui_invalidate(UI_DIRTY_TIME | UI_DIRTY_DATE);   // chỉ vẽ khi có trường nhấp nháy
+}
+
+static void on_up_repeat(stimer_t *t, void *ctx){
+  (void)t; (void)ctx;
+  if(mode == MODE_SET_TIME){
+    increment_field(editing_field);
+  } else if(mode == MODE_ALARM){
+    if(editing_field == FIELD_HOUR) wrap_inc(&alarm1.hour,0,23);
+    else if(editing_field == FIELD_MIN) wrap_inc(&alarm1.min,0,59);
+    else if(editing_field == FIELD_SEC) wrap_inc(&alarm1.sec,0,59);
+    alarm1_apply();
+  } else if(mode == MODE_COUNTDOWN && cd_at_preset()){
+    cd_step_preset();
   }
+  ui_invalidate(UI_DIRTY_TIME | UI_DIRTY_DATE | UI_DIRTY_SW);
 }
 
-/* ============ INIT & TICK ============ */
+static void on_alarm_end(stimer_t *t, void *ctx){
+  (void)t; (void)ctx;
+  alarm_active = false;
+  stimer_stop(&alarm_anim_timer);
+  ui_invalidate(UI_DIRTY_ALARM);   // xoá hiệu ứng
+}
+
+static void on_alarm_anim(stimer_t *t, void *ctx){
+  (void)t; (void)ctx;
+  alarm_inv = !alarm_inv;
+  ui_invalidate(UI_DIRTY_ALARM);
+}
+
+/* ============ INIT & TASKS ============ */
 void app_clock_init(void){
   ds3231_init();
-  read_ds3231_into_cur();
+  ds3231_IntInit();
+  lclock_init();
+  tz_set(APP_TZ);
+  poll_last_us = 0;
+  stimer_init(&blink_timer, on_blink, NULL);
+  stimer_init(&up_repeat_timer, on_up_repeat, NULL);
+  stimer_init(&alarm_timer, on_alarm_end, NULL);
+  stimer_init(&alarm_anim_timer, on_alarm_anim, NULL);
+  stimer_init(&minute_watchdog, NULL, NULL);
+  stimer_start(&minute_watchdog, MINUTE_TIMEOUT_MS, 0);
+  read_ds3231_into_cur();   // lúc khởi động được phép chặn, hàng đợi còn rỗng
+  set_cur(&cur);
   snapshot_from_cur();
-
-  blink_acc_ms = 0; blink_on = true;
-  up_hold_ms = 0; up_repeat_acc_ms = 0; up_was_pressed_last = false;
-
-  alarm_active = false; alarm_remain_ms = 0;
+  alarm_init();
+  alarm_ui_id = -1;
+  hw_deadline = ALARM_NONE;
+  hw_armed = false;
+  alarm1_apply();
+  hw_alarm_sync();
+
+  blink_on = true;
+  stimer_start(&blink_timer, BLINK_PERIOD_MS, BLINK_PERIOD_MS);
+  up_was_pressed_last = false;
+  alarm_active = false;
+
+  sw_reset();
+  cd_reset();
+  drawn_mode = MODE_VIEW;
 
   lcd_Clear(BLACK);
+
+  /* Khai báo task: chu kỳ, hạn, ưu tiên (RM) */
+  input_task = (task_t){ .name = "input", .fn = button_Scan,   .period_us = INPUT_PERIOD_US,  .prio = 0 };
+  logic_task = (task_t){ .name = "logic", .fn = logic_task_fn, .period_us = LOGIC_PERIOD_US,  .prio = 1 };
+  ui_task    = (task_t){ .name = "ui",    .fn = ui_task_fn,    .period_us = UI_PERIOD_US,     .prio = 2,
+                         .event = true };
+  rtc_task   = (task_t){ .name = "rtc",   .fn = rtc_task_fn,   .period_us = RTC_POLL_PERIOD_US, .prio = 3,
+                         .deadline_us = 20000 };
+  sched_add(&input_task);
+  sched_add(&logic_task);
+  sched_add(&ui_task);
+  sched_add(&rtc_task);
+  ui_invalidate(UI_DIRTY_ALL);
 }
 /* ============ Lab 4 (start) ============ */
-void app_clock_on_tick(void){
-  /* 1) Blink & hold/repeat */
-  blink_acc_ms += APP_TICK_MS;
-  if(blink_acc_ms >= BLINK_PERIOD_MS){
-    blink_acc_ms = 0;
-    blink_on = !blink_on;
-  }
+/* Task logic: nút, mode, báo thức. Không vẽ, chỉ đánh dấu UI cần vẽ lại */
+static void logic_task_fn(void){
+  PROF_ENTER(task_logic);
+  ds3231_Service();   // timeout giao dịch I2C / INT kẹt cần kiểm tra dày
 
+  /* 1) Giữ UP: timer lặp chạy từ lúc nhấn đến lúc nhả */
   bool up_now = btn_pressed_now(BTN_UP_IDX);
-  if(up_now){
-    if(!up_was_pressed_last){
-      up_was_pressed_last = true;
-      up_hold_ms = 0;
-      up_repeat_acc_ms = 0;
-    } else {
-      if(up_hold_ms < 60000) up_hold_ms += APP_TICK_MS;
-      if(up_hold_ms >= HOLD_THRESHOLD_MS){
-        up_repeat_acc_ms += APP_TICK_MS;
-        if(up_repeat_acc_ms >= REPEAT_STEP_MS){
-          up_repeat_acc_ms = 0;
-          if(mode == MODE_SET_TIME){
-            increment_field(editing_field);
-          } else if(mode == MODE_ALARM){
-            if(editing_field == FIELD_HOUR) wrap_inc(&alarm1.hour,0,23);
-            else if(editing_field == FIELD_MIN) wrap_inc(&alarm1.min,0,59);
-            else if(editing_field == FIELD_SEC) wrap_inc(&alarm1.sec,0,59);
-          }
-        }
-      }
-    }
-  } else {
-    up_was_pressed_last = false;
-    up_hold_ms = 0;
-    up_repeat_acc_ms = 0;
+  if(up_now && !up_was_pressed_last){
+    stimer_start(&up_repeat_timer, HOLD_THRESHOLD_MS + REPEAT_STEP_MS, REPEAT_STEP_MS);
+  } else if(!up_now && up_was_pressed_last){
+    stimer_stop(&up_repeat_timer);
   }
+  up_was_pressed_last = up_now;
 
-  /* 2) Cập nhật DS3231 nếu không ở SET (SET thì đóng băng thời gian) */
-  if(mode != MODE_SET_TIME){
-    read_ds3231_into_cur();
-  }
-
-  /* 3) Events nút */
-  bool ev_mode = btn_pressed_edge(BTN_MODE_IDX);
-  bool ev_up   = btn_pressed_edge(BTN_UP_IDX);
-  bool ev_ok   = btn_pressed_edge(BTN_OK_IDX);
+  /* 2) Events nút (đã chốt bởi task quét) */
+  uint16_t edges = button_TakeEdges();
+  bool ev_mode = btn_edge(edges, BTN_MODE_IDX);
+  bool ev_up   = btn_edge(edges, BTN_UP_IDX);
+  bool ev_ok   = btn_edge(edges, BTN_OK_IDX);
+  if(ev_mode || ev_up || ev_ok) ui_invalidate(UI_DIRTY_STATUS | UI_DIRTY_TIME | UI_DIRTY_DATE | UI_DIRTY_SW);
 
   if(ev_mode){
+    app_mode_t from = mode;
     if(mode == MODE_VIEW){
       mode = MODE_SET_TIME;
       editing_field = FIELD_HOUR;
@@ -249,9 +569,14 @@ void app_clock_on_tick(void){
       commit_edit_to_ds3231();
       mode = MODE_ALARM;
       editing_field = FIELD_HOUR;
+    } else if(mode == MODE_ALARM){
+      mode = MODE_STOPWATCH;
+    } else if(mode == MODE_STOPWATCH){
+      mode = MODE_COUNTDOWN;
     } else {
       mode = MODE_VIEW;
     }
+    TRACE(TRACE_MODE, from, mode);
   }
 
   switch(mode){
@@ -263,11 +588,9 @@ void app_clock_on_tick(void){
         increment_field(editing_field);
       }
       if(ev_ok){
-        editing_field = (field_t)((editing_field + 1) % FIELD_COUNT);
+        editing_field = next_edit_field(editing_field);
         if(editing_field == FIELD_SEC){
           commit_edit_to_ds3231();
-          read_ds3231_into_cur();
-          snapshot_from_cur();
         }
       }
       cur = edit; // hiển thị theo bản edit
@@ -278,29 +601,95 @@ void app_clock_on_tick(void){
         if(editing_field == FIELD_HOUR) wrap_inc(&alarm1.hour,0,23);
         else if(editing_field == FIELD_MIN) wrap_inc(&alarm1.min,0,59);
         else if(editing_field == FIELD_SEC) wrap_inc(&alarm1.sec,0,59);
+        alarm1_apply();
       }
       if(ev_ok){
         if(editing_field == FIELD_SEC){
           alarm1.enabled = !alarm1.enabled;
+          alarm1_apply();
           editing_field = FIELD_HOUR;
         } else {
-          editing_field = (field_t)(editing_field + 1);
+          editing_field = (field_t)(editing_field - 1);   // giờ -> phút -> giây (FIELD_SEC = 0)
         }
       }
       break;
+
+    case MODE_STOPWATCH:
+      if(ev_ok){
+        if(sw_running()) sw_stop(btn_event_us(BTN_OK_IDX));
+        else sw_start(btn_event_us(BTN_OK_IDX));
+      }
+      if(ev_up){
+        if(sw_running()) sw_lap(btn_event_us(BTN_UP_IDX));
+        else sw_reset();
+      }
+      break;
+
+    case MODE_COUNTDOWN:
+      if(ev_ok){
+        if(cd_running()) cd_stop(btn_event_us(BTN_OK_IDX));
+        else cd_start(btn_event_us(BTN_OK_IDX));
+      }
+      if(ev_up && !cd_running()){
+        if(cd_at_preset()) cd_step_preset();
+        else cd_reset();
+      }
+      break;
   }
 
-  /* 4) Alarm effect */
+  /* 3) Alarm effect (cả khi đếm ngược về 0, ở mọi mode) */
   maybe_trigger_alarm();
-  if(alarm_active){
-    if(alarm_remain_ms > APP_TICK_MS) alarm_remain_ms -= APP_TICK_MS;
-    else { alarm_remain_ms = 0; alarm_active = false; }
+  if(cd_take_expired(timer_now_us())){
+    start_alarm_effect();
+    ui_invalidate(UI_DIRTY_SW);   // khung cuối 00:00.00
   }
+  PROF_EXIT(task_logic);
+}
 
-  /* 5) Vẽ UI */
-  draw_status_bar();
-  draw_time_area(&cur);
-  draw_date_area(&cur);
-  draw_alarm_effect();
+/* Task đồng bộ DS3231: 1 Hz khi đã bám mốc (giây lật theo CC2), dày hơn khi dò */
+static void rtc_task_fn(void){
+  PROF_ENTER(task_rtc);
+  /* SET chỉ đóng băng phần hiển thị (edit); giờ thật vẫn chạy để báo thức không lỡ */
+  update_cur_time();
+  arm_second_boundary();
+  sched_set_period(&rtc_task, need_polling() ? RTC_POLL_PERIOD_US : RTC_PERIOD_US);
+  PROF_EXIT(task_rtc);
+}
+
+/* Task vẽ: chỉ chạy khi có vùng bẩn, tối đa UI_FRAME_CAP_HZ khung/s */
+static void ui_task_fn(void){
+  uint8_t d = ui_dirty;
+  ui_dirty = 0;
+  clk_gov_boost();   // vẽ ở 168 MHz, xong thì hạ
+  PROF_ENTER(task_ui);
+  if(drawn_mode != mode) d |= UI_DIRTY_ALL;
+  TRACE(TRACE_DRAW_BEGIN, d, mode);
+
+  if(d & UI_DIRTY_STATUS) draw_status_bar();
+  if(mode == MODE_STOPWATCH || mode == MODE_COUNTDOWN){
+    if(drawn_mode != mode) draw_sw_invalidate();
+    if(d & UI_DIRTY_SW) draw_sw_area();
+  } else {
+    if(drawn_mode == MODE_STOPWATCH || drawn_mode == MODE_COUNTDOWN) lcd_Fill(0,90,240,175,BLACK);
+    if(d & UI_DIRTY_TIME) draw_time_area(&cur);
+    if(d & UI_DIRTY_DATE) draw_date_area(&cur);
+  }
+  if(d & UI_DIRTY_ALARM) draw_alarm_effect();
+  drawn_mode = mode;
+
+  /* Bấm giờ đang chạy: tự hẹn khung kế, nhịp theo frame cap chứ không theo logic */
+  if(sw_running() || cd_running()) ui_invalidate(UI_DIRTY_SW);
+  TRACE(TRACE_DRAW_END, d, 0);
+  PROF_EXIT(task_ui);
+  clk_gov_relax();
 }
 /* ============ Lab 4 (end) ============ */
+
+/* Gọi khi flag_oneshot bật (ranh giới giây dự đoán), ngoài lịch của task */
+void app_clock_on_second(void){
+  if(need_polling()) return;
+  /* Ngắt đến đúng ranh giới ± vài µs: dung sai 2 ms để chắc chắn sang giây mới.
+   * flip_to đánh dấu UI -> task vẽ chạy ngay ở lượt sched_run kế */
+  flip_to((uint32_t)((lclock_now_us() + 2000u) / 1000000u));
+  arm_second_boundary();
+}
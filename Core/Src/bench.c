@@ -0,0 +1,200 @@
+/*
+ * bench.c
+ *
+ *  Chuỗi đo cố định trên chip (xem bench.h). Mỗi phép đo là một hàm trả về
+ *  số chu kỳ HCLK của một lần chạy; bench_measure gom min/max/tổng.
+ */
+#include <stdio.h>
+#include "bench.h"
+#include "button.h"
+#include "clock_gov.h"
+#include "ds3231.h"
+#include "lcd.h"
+
+bench_env_t    bench_env;
+bench_result_t bench_results[BENCH_N];
+
+#if BENCH_ENABLE
+
+#define BENCH_ALARM_REG		0x07		// Alarm1 + Alarm2: 7 byte như khối thời gian
+
+typedef uint32_t (*bench_fn_t)(uint32_t i);
+
+static uint8_t alarm_regs[7];
+static uint32_t isr_base_cyc;
+
+/* ============ Các phép đo ============ */
+static uint32_t op_fill(uint32_t i){
+	uint32_t t0 = DWT->CYCCNT;
+	lcd_Fill(0, 0, lcddev.width, lcddev.height, (i & 1) ? BLUE : BLACK);
+	return DWT->CYCCNT - t0;
+}
+
+static uint32_t op_glyph(uint32_t i){
+	uint16_t x = (uint16_t)((i % 20) * 12), y = (uint16_t)((i / 20) * 24);
+	uint32_t t0 = DWT->CYCCNT;
+	lcd_ShowChar(x, y, (uint8_t)('0' + i % 10), WHITE, BLACK, 24, 0);
+	return DWT->CYCCNT - t0;
+}
+
+static uint32_t op_line(uint32_t i){
+	uint16_t x = (uint16_t)(i * 2);
+	uint32_t t0 = DWT->CYCCNT;
+	lcd_DrawLine(x, 0, x + 99, 99, YELLOW);
+	return DWT->CYCCNT - t0;
+}
+
+static uint32_t op_circle(uint32_t i){
+	uint32_t t0 = DWT->CYCCNT;
+	lcd_DrawCircle(120, 160, (i & 1) ? RED : GREEN, 50, 1);
+	return DWT->CYCCNT - t0;
+}
+
+static uint32_t op_i2c_read(uint32_t i){
+	ds3231_time_t t;
+	uint32_t t0 = DWT->CYCCNT;
+	(void)i;
+	ds3231_GetTime(&t);
+	return DWT->CYCCNT - t0;
+}
+
+/* Ghi lại đúng giá trị vừa đọc: báo thức và mốc phút không đổi */
+static uint32_t op_i2c_write(uint32_t i){
+	uint32_t t0 = DWT->CYCCNT;
+	(void)i;
+	ds3231_WriteRegs(BENCH_ALARM_REG, alarm_regs, sizeof(alarm_regs));
+	return DWT->CYCCNT - t0;
+}
+
+/* Từ lúc chốt 74HC165 tới khi ngắt SPI nhận xong (giải mã chạy ngay sau ở PendSV) */
+static uint32_t op_spi_scan(uint32_t i){
+	uint32_t t0 = DWT->CYCCNT;
+	(void)i;
+	button_Scan();
+	while(HAL_SPI_GetState(&hspi1) != HAL_SPI_STATE_READY);
+	return DWT->CYCCNT - t0;
+}
+
+/* Bật lại TIM2 khi CC1 đang chờ: ngắt chạy ngay giữa hai lần đọc CYCCNT.
+ * Với pend = 0 chỉ còn chi phí bật NVIC, trừ đi ở lần đo thật */
+static uint32_t isr_once(uint8_t pend){
+	uint32_t t0;
+	HAL_NVIC_DisableIRQ(TIM2_IRQn);
+	if(pend) TIM2->EGR = TIM_EGR_CC1G;
+	t0 = DWT->CYCCNT;
+	HAL_NVIC_EnableIRQ(TIM2_IRQn);
+	__DSB();
+	__ISB();
+	return DWT->CYCCNT - t0;
+}
+
+static uint32_t op_tim2_isr(uint32_t i){
+	uint32_t dt = isr_once(1);
+	(void)i;
+	return (dt > isr_base_cyc) ? dt - isr_base_cyc : 0;
+}
+
+static void bench_measure(bench_id_t id, const char *name, bench_fn_t fn, uint32_t ops, uint32_t units){
+	bench_result_t *r = &bench_results[id];
+	uint32_t mhz = bench_env.hclk_hz / 1000000u;
+	r->name = name;
+	r->ops = ops;
+	r->units = units;
+	r->cyc_min = 0xFFFFFFFFu;
+	r->cyc_max = 0;
+	r->cyc_total = 0;
+	for(uint32_t i = 0; i < ops; i++){
+		uint32_t dt = fn(i);
+		r->cyc_total += dt;
+		if(dt < r->cyc_min) r->cyc_min = dt;
+		if(dt > r->cyc_max) r->cyc_max = dt;
+	}
+	if(!ops) return;		// thiết bị không trả lời: để trống dòng
+	r->per_s = r->cyc_total ? (uint32_t)((uint64_t)ops * units * bench_env.hclk_hz / r->cyc_total) : 0;
+	r->ns_avg = (uint32_t)(r->cyc_total * 1000u / ((uint64_t)ops * mhz));
+}
+
+/* ============ Hiển thị ============ */
+static void bench_line(uint16_t y, const char *s){
+	lcd_ShowStr(4, y, (uint8_t *)s, WHITE, BLACK, 16, 0);
+}
+
+static void bench_show(void){
+	static const char *unit[BENCH_N] = { "px/s", "ch/s", "ln/s", "ci/s" };
+	char s[32];
+	uint16_t y = 4;
+
+	lcd_Clear(BLACK);
+	snprintf(s, sizeof(s), "BENCH %luMHz I2C %lukHz", (unsigned long)(bench_env.hclk_hz / 1000000u),
+	         (unsigned long)(bench_env.i2c_hz / 1000u));
+	bench_line(y, s);
+	y += 20;
+	snprintf(s, sizeof(s), "FSMC W %lu/%lu R %lu/%lu", (unsigned long)(bench_env.fsmc_bwtr & 0xF),
+	         (unsigned long)((bench_env.fsmc_bwtr >> 8) & 0xFF), (unsigned long)(bench_env.fsmc_btr & 0xF),
+	         (unsigned long)((bench_env.fsmc_btr >> 8) & 0xFF));
+	bench_line(y, s);
+	y += 28;
+	for(int i = 0; i < BENCH_N; i++, y += 20){
+		const bench_result_t *r = &bench_results[i];
+		uint32_t mhz = bench_env.hclk_hz / 1000000u;
+		if(!r->ops){
+			snprintf(s, sizeof(s), "%-8s     --", r->name);
+		} else if(unit[i]){
+			snprintf(s, sizeof(s), "%-8s%10lu %s", r->name, (unsigned long)r->per_s, unit[i]);
+		} else {
+			uint32_t max_ns = r->cyc_max * 1000u / mhz;
+			snprintf(s, sizeof(s), "%-8s%5lu.%luus mx%lu.%lu", r->name,
+			         (unsigned long)(r->ns_avg / 1000u), (unsigned long)(r->ns_avg / 100u % 10u),
+			         (unsigned long)(max_ns / 1000u), (unsigned long)(max_ns / 100u % 10u));
+		}
+		bench_line(y, s);
+	}
+	bench_line(y + 12, "any key: clock");
+}
+
+/* ============ API ============ */
+uint8_t bench_requested(void){
+	for(uint8_t i = 0; i < BUTTON_DEBOUNCE_US / 1000u + 2u; i++){
+		button_Scan();
+		HAL_Delay(1);
+	}
+	button_TakeEdges();		// cạnh của phím đang giữ không lọt sang app
+	return (button_down >> BENCH_KEY_IDX) & 1u;
+}
+
+void bench_run(void){
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;		// như prof_init, cả bản không DEBUG
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+	clk_gov_set(CLK_PERF);
+
+	bench_env.hclk_hz = HAL_RCC_GetHCLKFreq();
+	bench_env.i2c_hz = hi2c1.Init.ClockSpeed;
+	bench_env.fsmc_btr = FSMC_Bank1->BTCR[1];
+	bench_env.fsmc_bwtr = FSMC_Bank1E->BWTR[0];
+
+	bench_measure(BENCH_FILL,   "fill",   op_fill,   4,   (uint32_t)lcddev.width * lcddev.height);
+	bench_measure(BENCH_GLYPH,  "glyph",  op_glyph,  200, 1);
+	bench_measure(BENCH_LINE,   "line",   op_line,   60,  1);
+	bench_measure(BENCH_CIRCLE, "circle", op_circle, 6,   1);
+
+	bench_measure(BENCH_I2C_READ, "i2c rd", op_i2c_read, 20, 1);
+	bench_measure(BENCH_I2C_WRITE, "i2c wr", op_i2c_write,
+	              (ds3231_ReadRegs(BENCH_ALARM_REG, alarm_regs, sizeof(alarm_regs)) == HAL_OK) ? 20 : 0, 1);
+	bench_measure(BENCH_SPI_SCAN, "spi btn", op_spi_scan, 50, 1);
+
+	isr_base_cyc = 0xFFFFFFFFu;
+	for(int i = 0; i < 16; i++){
+		uint32_t dt = isr_once(0);
+		if(dt < isr_base_cyc) isr_base_cyc = dt;
+	}
+	bench_measure(BENCH_TIM2_ISR, "tim2 isr", op_tim2_isr, 50, 1);
+
+	bench_show();
+	button_TakeEdges();
+	do {
+		button_Scan();
+		HAL_Delay(1);
+	} while(!button_TakeEdges());
+}
+
+#endif /* BENCH_ENABLE */
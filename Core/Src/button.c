@@ -13,19 +13,40 @@
  */
 #include "button.h"
 #include "main.h"     // <-- bổ sung: có BTN_LOAD_GPIO_Port/Pin
+#include "software_timer.h"
+#include "workq.h"
+#include "prof.h"
+#include "trace.h"
 uint16_t button_count[16];
+uint16_t button_down = 0;
 uint16_t spi_button = 0x0000;
+uint64_t button_scan_us = 0;   // thời điểm chốt trạng thái nút (TIM2)
+uint64_t button_press_us[16];  // lúc mẫu "nhấn" đầu tiên của lần nhấn hiện tại
+static uint16_t button_edges = 0;   // cạnh nhấn đã lọc, chờ app lấy
+
+PROF_ZONE(button_Scan);
+PROF_ZONE(button_decode);
 
 void button_init(){
 	HAL_GPIO_WritePin(BTN_LOAD_GPIO_Port, BTN_LOAD_Pin, 1);
 }
 
+/* Chốt 74HC165 rồi đọc bằng SPI ngắt; giải mã ở PendSV khi nhận xong */
 void button_Scan(){
+	  if(HAL_SPI_GetState(&hspi1) != HAL_SPI_STATE_READY) return;   // lần trước chưa xong: bỏ lượt
+	  PROF_ENTER(button_Scan);
 	  HAL_GPIO_WritePin(BTN_LOAD_GPIO_Port, BTN_LOAD_Pin, 0);
 	  HAL_GPIO_WritePin(BTN_LOAD_GPIO_Port, BTN_LOAD_Pin, 1);
-	  HAL_SPI_Receive(&hspi1, (void*)&spi_button, 2, 10);
+	  button_scan_us = timer_now_us();
+	  TRACE(TRACE_SPI_SCAN, 0, 0);
+	  HAL_SPI_Receive_IT(&hspi1, (void*)&spi_button, 2);
+	  PROF_EXIT(button_Scan);
+}
+
+static void button_decode(uint32_t word){
 	  int button_index = 0;
-	  uint16_t mask = 0x8000;
+	  uint16_t mask = 0x8000, bit;
+	  PROF_ENTER(button_decode);
 	  for(int i = 0; i < 16; i++){
 		  if(i >= 0 && i <= 3){
 			  button_index = i + 4; // do theo schematic thì spi gửi ko giống như button trên mạch
@@ -36,12 +57,39 @@ void button_Scan(){
 		  } else {
 			  button_index = 23 - i;
 		  }
-		  if(spi_button & mask) button_count[button_index] = 0;
-		  else button_count[button_index]++;
+		  bit = (uint16_t)(1u << button_index);
+		  if(word & mask){
+			  button_count[button_index] = 0;
+			  button_down &= (uint16_t)~bit;
+		  } else if(button_count[button_index] < 0xFFFF) button_count[button_index]++;   // giữ lâu không quay về 0
+		  if(button_count[button_index] == 1) button_press_us[button_index] = button_scan_us;
+		  /* Quét nhanh hơn vòng xử lý: chốt cạnh lại để app không lỡ */
+		  if(button_count[button_index] && !(button_down & bit) &&
+		     button_scan_us - button_press_us[button_index] >= BUTTON_DEBOUNCE_US){
+			  button_down |= bit;
+			  button_edges |= bit;
+		  }
 //		  if(spi_button & mask) button_count[i] = 0;
 //		  else button_count[i]++;
 		  mask = mask >> 1;
 	  }
+	  PROF_EXIT(button_decode);
+}
+
+/* ISR SPI chỉ chuyển word sang PendSV; đầy hàng đợi thì giải mã luôn tại chỗ */
+void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *hspi){
+	  if(hspi->Instance != SPI1) return;
+	  TRACE(TRACE_SPI_DONE, spi_button, 0);
+	  if(workq_post(button_decode, spi_button) != HAL_OK) button_decode(spi_button);
+}
+
+uint16_t button_TakeEdges(void){
+	uint16_t e;
+	__disable_irq();   // PendSV có thể đang giải mã giữa đọc và xoá
+	e = button_edges;
+	button_edges = 0;
+	__enable_irq();
+	return e;
 }
 
 
@@ -0,0 +1,84 @@
+/*
+ * calendar.c
+ */
+#include "calendar.h"
+
+#define DAYS_PER_4Y			1461u
+
+static const uint8_t cal_dim[2][13] = {
+	{ 0, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 },
+	{ 0, 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 }
+};
+
+/* Số ngày trước ngày 1 của tháng; cột 13 = số ngày cả năm */
+static const uint16_t cal_cum[2][14] = {
+	{ 0, 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334, 365 },
+	{ 0, 0, 31, 60, 91, 121, 152, 182, 213, 244, 274, 305, 335, 366 }
+};
+
+/* Số ngày trước năm thứ i trong chu kỳ 4 năm (năm đầu nhuận) */
+static const uint16_t cal_quad[5] = { 0, 366, 731, 1096, 1461 };
+
+uint8_t cal_days_in_month(uint8_t month, uint8_t year){
+	if(month < 1 || month > 12) return 31;
+	return cal_dim[cal_is_leap(year)][month];
+}
+
+static uint32_t cal_days(uint8_t date, uint8_t month, uint8_t year){
+	return (uint32_t)(year / 4u) * DAYS_PER_4Y + cal_quad[year % 4u]
+	     + cal_cum[cal_is_leap(year)][month] + (uint32_t)(date - 1u);
+}
+
+uint8_t cal_weekday(uint8_t date, uint8_t month, uint8_t year){
+	return cal_weekday_of_days(cal_days(date, month, year));
+}
+
+uint32_t cal_to_sec(const ds3231_time_t *t){
+	return cal_days(t->date, t->month, t->year) * CAL_SEC_PER_DAY
+	     + (uint32_t)t->hour * 3600u + (uint32_t)t->min * 60u + t->sec;
+}
+
+void cal_from_sec(uint32_t s, ds3231_time_t *t){
+	uint32_t days = s / CAL_SEC_PER_DAY;
+	uint32_t rem  = s % CAL_SEC_PER_DAY;
+	uint32_t q    = days / DAYS_PER_4Y;
+	uint32_t d    = days % DAYS_PER_4Y;
+	uint8_t  y    = (uint8_t)((d >= cal_quad[1]) + (d >= cal_quad[2]) + (d >= cal_quad[3]));
+	uint8_t  m;
+	const uint16_t *cum;
+
+	d  -= cal_quad[y];
+	y   = (uint8_t)(q * 4u + y);
+	cum = cal_cum[cal_is_leap(y)];
+	m   = (uint8_t)(d / 32u + 1u);		// ước lượng thấp, sửa tối đa một bước
+	if(d >= cum[m + 1]) m++;
+
+	t->hour  = (uint8_t)(rem / 3600u);
+	t->min   = (uint8_t)(rem / 60u % 60u);
+	t->sec   = (uint8_t)(rem % 60u);
+	t->year  = (uint8_t)(y % 100u);		// quá 2099 thì quay vòng như DS3231
+	t->month = m;
+	t->date  = (uint8_t)(d - cum[m] + 1u);
+	t->day   = cal_weekday_of_days(days);
+}
+
+bool cal_valid(const ds3231_time_t *t){
+	if(t->sec > 59 || t->min > 59 || t->hour > 23) return false;
+	if(t->year > 99 || t->month < 1 || t->month > 12) return false;
+	if(t->date < 1 || t->date > cal_days_in_month(t->month, t->year)) return false;
+	return t->day == cal_weekday(t->date, t->month, t->year);
+}
+
+void cal_normalize(ds3231_time_t *t){
+	uint8_t dim;
+	if(t->sec  > 59) t->sec  = 59;
+	if(t->min  > 59) t->min  = 59;
+	if(t->hour > 23) t->hour = 23;
+	if(t->year > 99) t->year = 99;
+	if(t->month < 1) t->month = 1;
+	if(t->month > 12) t->month = 12;
+	dim = cal_days_in_month(t->month, t->year);
+	if(t->date < 1) t->date = 1;
+	if(t->date > dim) t->date = dim;
+	t->day = cal_weekday(t->date, t->month, t->year);
+}
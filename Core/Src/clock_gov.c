@@ -0,0 +1,162 @@
+/*
+ * clock_gov.c
+ */
+#include "clock_gov.h"
+#include "software_timer.h"
+#include "ds3231.h"
+#include "trace.h"
+
+#define CLK_PLL_LOCK_TIMEOUT_MS	2
+#define CLK_BUS_IDLE_WAIT_MS	2		// boost chờ I2C/SPI xong tối đa chừng này
+
+typedef struct {
+	uint32_t cfgr;			// SW | HPRE | PPRE1 | PPRE2
+	uint32_t flash_ws;
+	uint32_t tim2_hz;		// xung vào TIM2 (APB1 x2 nếu APB1 chia)
+	uint8_t  pll;
+} clk_def_t;
+
+static const clk_def_t clk_defs[CLK_PROFILE_N] = {
+	[CLK_PERF] = { RCC_CFGR_SW_PLL | RCC_CFGR_HPRE_DIV1 | RCC_CFGR_PPRE1_DIV4 | RCC_CFGR_PPRE2_DIV4,
+	               FLASH_LATENCY_5, 84000000u, 1 },
+	[CLK_MID]  = { RCC_CFGR_SW_PLL | RCC_CFGR_HPRE_DIV2 | RCC_CFGR_PPRE1_DIV2 | RCC_CFGR_PPRE2_DIV2,
+	               FLASH_LATENCY_2, 84000000u, 1 },
+	[CLK_LOW]  = { RCC_CFGR_SW_HSI | RCC_CFGR_HPRE_DIV1 | RCC_CFGR_PPRE1_DIV1 | RCC_CFGR_PPRE2_DIV1,
+	               FLASH_LATENCY_0, 16000000u, 0 },
+};
+
+#define CLK_CFGR_MASK	(RCC_CFGR_SW | RCC_CFGR_HPRE | RCC_CFGR_PPRE1 | RCC_CFGR_PPRE2)
+
+static clk_profile_t clk_cur = CLK_PERF;
+static uint64_t clk_since_us = 0;
+static uint64_t clk_residency[CLK_PROFILE_N];
+static uint64_t clk_relax_us = 0;
+
+void clk_gov_init(void){
+	/* SystemClock_Config để sẵn PERF */
+	clk_cur = CLK_PERF;
+	clk_since_us = timer_now_us();
+	clk_relax_us = clk_since_us;
+	for(int i = 0; i < CLK_PROFILE_N; i++) clk_residency[i] = 0;
+}
+
+clk_profile_t clk_gov_profile(void){
+	return clk_cur;
+}
+
+uint64_t clk_gov_residency_us(clk_profile_t p){
+	uint64_t r = clk_residency[p];
+	if(p == clk_cur) r += timer_now_us() - clk_since_us;
+	return r;
+}
+
+static uint8_t clk_bus_busy(void){
+	return ds3231_Busy() || HAL_SPI_GetState(&hspi1) != HAL_SPI_STATE_READY;
+}
+
+/* Chọn bộ chia SPI nhỏ nhất không vượt CLK_SPI_MAX_HZ */
+static uint32_t clk_spi_prescaler(uint32_t pclk){
+	static const uint32_t br[] = {
+		SPI_BAUDRATEPRESCALER_2,  SPI_BAUDRATEPRESCALER_4,  SPI_BAUDRATEPRESCALER_8,
+		SPI_BAUDRATEPRESCALER_16, SPI_BAUDRATEPRESCALER_32, SPI_BAUDRATEPRESCALER_64,
+		SPI_BAUDRATEPRESCALER_128
+	};
+	uint32_t i;
+	for(i = 0; i < sizeof(br) / sizeof(br[0]); i++){
+		if((pclk >> (i + 1)) <= CLK_SPI_MAX_HZ) return br[i];
+	}
+	return SPI_BAUDRATEPRESCALER_256;
+}
+
+/* PCLK đổi: tính lại CCR/TRISE của I2C và bộ chia SPI (ngoại vi đang rảnh) */
+static void clk_reinit_buses(void){
+	HAL_I2C_Init(&hi2c1);
+	hspi1.Init.BaudRatePrescaler = clk_spi_prescaler(HAL_RCC_GetPCLK2Freq());
+	HAL_SPI_Init(&hspi1);
+}
+
+static HAL_StatusTypeDef clk_pll_on(void){
+	uint32_t t0;
+	if(RCC->CR & RCC_CR_PLLRDY) return HAL_OK;
+	RCC->CR |= RCC_CR_PLLON;				// PLLCFGR giữ nguyên từ SystemClock_Config
+	t0 = HAL_GetTick();
+	while(!(RCC->CR & RCC_CR_PLLRDY)){
+		if(HAL_GetTick() - t0 > CLK_PLL_LOCK_TIMEOUT_MS){
+			RCC->CR &= ~RCC_CR_PLLON;
+			return HAL_TIMEOUT;
+		}
+	}
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef clk_gov_set(clk_profile_t p){
+	const clk_def_t *to = &clk_defs[p], *from = &clk_defs[clk_cur];
+	uint32_t cfgr, old_hz = SystemCoreClock;
+	uint8_t retime;
+	uint64_t now;
+
+	if(p == clk_cur) return HAL_OK;
+	retime = to->tim2_hz != from->tim2_hz;
+	/* Khoá PLL trước (ngắt vẫn chạy), ~100 µs */
+	if(to->pll && clk_pll_on() != HAL_OK) return HAL_TIMEOUT;
+
+	__disable_irq();
+	/* Kiểm tra trong vùng khoá: PendSV có thể vừa xếp giao dịch I2C.
+	 * Rảnh thì giữ hàng đợi I2C đến khi bus được tính lại theo PCLK mới
+	 * (SPI chỉ được khởi động từ vòng chính, không chen vào được) */
+	if(retime && clk_bus_busy()){
+		__enable_irq();
+		return HAL_BUSY;
+	}
+	if(retime) ds3231_Hold(1);
+	if(to->flash_ws > from->flash_ws) __HAL_FLASH_SET_LATENCY(to->flash_ws);
+	cfgr = (RCC->CFGR & ~CLK_CFGR_MASK) | to->cfgr;
+	if(retime){
+		timer_retime(to->tim2_hz, &RCC->CFGR, cfgr);
+	} else {
+		RCC->CFGR = cfgr;					// PCLK và TIM2 không đổi: không cần gì thêm
+	}
+	while((RCC->CFGR & RCC_CFGR_SWS) != ((to->cfgr & RCC_CFGR_SW) << RCC_CFGR_SWS_Pos));
+	if(to->flash_ws < from->flash_ws) __HAL_FLASH_SET_LATENCY(to->flash_ws);
+	SystemCoreClockUpdate();
+	if(!to->pll) RCC->CR &= ~RCC_CR_PLLON;
+
+	now = timer_now_us();
+	clk_residency[clk_cur] += now - clk_since_us;
+	clk_since_us = now;
+	clk_cur = p;
+	trace_clock(old_hz);
+	__enable_irq();
+
+	/* Chỉ CFGR + TIM2 cần nguyên tử; HAL_*_Init (cả MspInit) chạy với ngắt bật */
+	if(retime){
+		clk_reinit_buses();
+		ds3231_Hold(0);
+	}
+	return HAL_OK;
+}
+
+void clk_gov_boost(void){
+	uint32_t t0;
+	if(clk_cur == CLK_PERF) return;
+	if(clk_cur == CLK_LOW){
+		/* Phải đổi PCLK: đợi giao dịch đang chạy xong (vài trăm µs) */
+		t0 = HAL_GetTick();
+		while(clk_gov_set(CLK_PERF) == HAL_BUSY){
+			if(HAL_GetTick() - t0 > CLK_BUS_IDLE_WAIT_MS) return;   // vẽ chậm một lần
+		}
+		return;
+	}
+	clk_gov_set(CLK_PERF);
+}
+
+void clk_gov_relax(void){
+	clk_relax_us = timer_now_us();
+	if(clk_cur == CLK_PERF) clk_gov_set(CLK_MID);
+}
+
+void clk_gov_idle(void){
+	if(clk_cur != CLK_MID) return;
+	if(timer_now_us() - clk_relax_us < CLK_LOW_AFTER_MS * 1000ull) return;
+	clk_gov_set(CLK_LOW);					// bus bận thì thử lại lần ngủ sau
+}
@@ -0,0 +1,58 @@
+/*
+ * dlog.c
+ */
+#include "dlog.h"
+#include "software_timer.h"
+
+#if DLOG_ENABLE
+
+extern const char __start_dlog_fmt[];			// linker script (chip) hoặc ld tự tạo (host)
+extern int __io_putchar(int ch) __attribute__((weak));
+int _write(int file, char *ptr, int len);
+
+dlog_buf_t dlog_buf;
+
+void dlog_init(void){
+	dlog_buf.magic = DLOG_MAGIC;
+	dlog_buf.n = DLOG_RING_N;
+	dlog_buf.head = 0;
+	dlog_buf.sent = 0;
+	dlog_buf.dropped = 0;
+}
+
+/* Vài lần ghi với ngắt tắt; ISR cũng gọi được */
+void dlog_emit(const char *fmt, const uint32_t *arg, uint32_t n){
+	uint32_t primask = __get_PRIMASK();
+	dlog_rec_t *r;
+	uint32_t h;
+	__disable_irq();
+	h = dlog_buf.head++;
+	if(h - dlog_buf.sent >= DLOG_RING_N){
+		dlog_buf.sent++;
+		dlog_buf.dropped++;
+	}
+	r = &dlog_buf.rec[h & (DLOG_RING_N - 1)];
+	r->hdr = (uint32_t)(fmt - __start_dlog_fmt) | (n << 28);
+	r->ts = timer_now_us32();
+	for(uint32_t i = 0; i < n; i++) r->arg[i] = arg[i];
+	__set_PRIMASK(primask);
+}
+
+/* Chỉ hdr, ts và các tham số có thật: 8..24 byte mỗi bản ghi */
+void dlog_flush(void){
+	dlog_rec_t r;
+	if(!__io_putchar) return;
+	while(1){
+		__disable_irq();
+		if(dlog_buf.sent == dlog_buf.head){
+			__enable_irq();
+			return;
+		}
+		r = dlog_buf.rec[dlog_buf.sent & (DLOG_RING_N - 1)];
+		dlog_buf.sent++;
+		__enable_irq();
+		_write(DLOG_FD, (char *)&r, (int)(8 + 4 * (r.hdr >> 28)));
+	}
+}
+
+#endif /* DLOG_ENABLE */
@@ -7,6 +7,12 @@
 #include "ds3231.h"
 #include "main.h"   // <-- bổ sung
 #include "utils.h"  // <-- bổ sung: DEC2BCD/BCD2DEC
+#include "local_clock.h"
+#include "workq.h"
+#include "prof.h"
+#include "trace.h"
+#include "dlog.h"
+#include <string.h>
 #define DS3231_ADDRESS 0x68<<1
 
 uint8_t ds3231_buffer[7];
@@ -19,6 +25,63 @@ uint8_t ds3231_day;
 uint8_t ds3231_month;
 uint8_t ds3231_year;
 
+/* Control: INTCN + A2IE luôn bật, A1IE theo báo thức người dùng */
+#define DS3231_CTRL_A1IE	0x01
+#define DS3231_CTRL_A2IE	0x02
+#define DS3231_CTRL_INTCN	0x04
+#define DS3231_STAT_A1F		0x01
+#define DS3231_STAT_A2F		0x02
+#define DS3231_INT_STUCK_MS	100		// INT giữ mức thấp quá lâu -> đọc lại status
+
+static uint8_t ds3231_ctrl = DS3231_CTRL_INTCN | DS3231_CTRL_A2IE;
+
+static volatile uint32_t ds3231_a1_count = 0;		// chỉ ngữ cảnh ngắt ghi
+static volatile uint32_t ds3231_a2_count = 0;
+static volatile uint64_t ds3231_int_stamp_us = 0;	// cạnh INT gần nhất
+static volatile uint64_t ds3231_a2_stamp_us = 0;
+static volatile uint8_t  ds3231_int_busy = 0;		// đang đọc/xoá status
+static uint32_t ds3231_int_low_since = 0;
+static uint32_t ds3231_a1_taken = 0;
+static uint32_t ds3231_a2_taken = 0;
+
+/* ===== Hàng đợi giao dịch bất đồng bộ ===== */
+#define DS3231_QUEUE_LEN	8		// luỹ thừa của 2
+#define DS3231_XFER_TIMEOUT	20		// ms, gỡ treo trong ds3231_Service()
+
+typedef struct {
+	uint8_t reg;
+	uint8_t len;
+	uint8_t write;
+	uint8_t data[DS3231_XFER_MAX];
+	ds3231_cb_t cb;
+	void *ctx;
+} ds3231_req_t;
+
+static ds3231_req_t ds3231_queue[DS3231_QUEUE_LEN];
+static volatile uint8_t ds3231_q_head = 0;		// phần tử đang/sắp chạy
+static volatile uint8_t ds3231_q_tail = 0;
+static volatile uint8_t ds3231_active = 0;
+static volatile uint8_t ds3231_held = 0;
+static volatile uint32_t ds3231_active_since = 0;
+static uint64_t ds3231_active_us = 0;
+
+static inline uint8_t ds3231_queue_free(void){
+	return (uint8_t)(DS3231_QUEUE_LEN - (uint8_t)(ds3231_q_tail - ds3231_q_head));
+}
+
+static HAL_StatusTypeDef ds3231_enqueue(uint8_t reg, const uint8_t *data, uint8_t len, uint8_t write,
+                                        ds3231_cb_t cb, void *ctx);
+static void ds3231_start_next(void);
+
+/* Snapshot thời gian, seqlock: seq lẻ = đang ghi (chỉ ISR ghi) */
+static volatile uint32_t ds3231_snap_seq = 0;
+static ds3231_time_t ds3231_snap;
+static uint64_t ds3231_snap_us;
+static uint32_t ds3231_snap_taken = 0;
+
+static ds3231_time_t ds3231_pending_write;
+volatile uint32_t ds3231_verify_errors = 0;
+
 void ds3231_init(){
 	ds3231_buffer[0] = DEC2BCD(30); //second
 	ds3231_buffer[1] = DEC2BCD(22); //minute
@@ -37,14 +100,441 @@ void ds3231_Write(uint8_t address, uint8_t value){
 	HAL_I2C_Mem_Write(&hi2c1, DS3231_ADDRESS, address, I2C_MEMADD_SIZE_8BIT, &temp, 1,10);
 }
 
+PROF_ZONE(ds3231_ReadTime);
+PROF_ZONE(ds3231_publish);
+
 void ds3231_ReadTime(){
-	HAL_I2C_Mem_Read(&hi2c1, DS3231_ADDRESS, 0x00, I2C_MEMADD_SIZE_8BIT, ds3231_buffer, 7, 10);
-	ds3231_sec = BCD2DEC(ds3231_buffer[0]);
-	ds3231_min = BCD2DEC(ds3231_buffer[1]);
-	ds3231_hours = BCD2DEC(ds3231_buffer[2]);
-	ds3231_day = BCD2DEC(ds3231_buffer[3]);
-	ds3231_date = BCD2DEC(ds3231_buffer[4]);
-	ds3231_month = BCD2DEC(ds3231_buffer[5]);
-	ds3231_year = BCD2DEC(ds3231_buffer[6]);
+	ds3231_time_t t;
+	PROF_ENTER(ds3231_ReadTime);
+	if(ds3231_GetTime(&t) == HAL_OK){
+		ds3231_sec = t.sec;
+		ds3231_min = t.min;
+		ds3231_hours = t.hour;
+		ds3231_day = t.day;
+		ds3231_date = t.date;
+		ds3231_month = t.month;
+		ds3231_year = t.year;
+	}
+	PROF_EXIT(ds3231_ReadTime);
+}
+
+/* Mặt nạ bỏ các bit không thuộc giá trị: CH/12-24h/century */
+static const uint8_t ds3231_time_mask[7] = { 0x7F, 0x7F, 0x3F, 0x07, 0x3F, 0x1F, 0xFF };
+
+static void ds3231_unpack(const uint8_t *raw, ds3231_time_t *t){
+	t->sec   = BCD2DEC(raw[0] & ds3231_time_mask[0]);
+	t->min   = BCD2DEC(raw[1] & ds3231_time_mask[1]);
+	t->hour  = BCD2DEC(raw[2] & ds3231_time_mask[2]);
+	t->day   = BCD2DEC(raw[3] & ds3231_time_mask[3]);
+	t->date  = BCD2DEC(raw[4] & ds3231_time_mask[4]);
+	t->month = BCD2DEC(raw[5] & ds3231_time_mask[5]);
+	t->year  = BCD2DEC(raw[6] & ds3231_time_mask[6]);
+}
+
+static void ds3231_pack(const ds3231_time_t *t, uint8_t *raw){
+	raw[0] = DEC2BCD(t->sec);
+	raw[1] = DEC2BCD(t->min);
+	raw[2] = DEC2BCD(t->hour);   // bit 6 = 0 -> chế độ 24h
+	raw[3] = DEC2BCD(t->day);
+	raw[4] = DEC2BCD(t->date);
+	raw[5] = DEC2BCD(t->month);
+	raw[6] = DEC2BCD(t->year);
+}
+
+HAL_StatusTypeDef ds3231_GetTime(ds3231_time_t *t){
+	if(HAL_I2C_Mem_Read(&hi2c1, DS3231_ADDRESS, ADDRESS_SEC, I2C_MEMADD_SIZE_8BIT, ds3231_buffer, 7, 10) != HAL_OK){
+		return HAL_ERROR;
+	}
+	ds3231_unpack(ds3231_buffer, t);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef ds3231_ReadRegs(uint8_t reg, uint8_t *buf, uint8_t len){
+	return HAL_I2C_Mem_Read(&hi2c1, DS3231_ADDRESS, reg, I2C_MEMADD_SIZE_8BIT, buf, len, 10);
+}
+
+HAL_StatusTypeDef ds3231_WriteRegs(uint8_t reg, const uint8_t *buf, uint8_t len){
+	return HAL_I2C_Mem_Write(&hi2c1, DS3231_ADDRESS, reg, I2C_MEMADD_SIZE_8BIT, (uint8_t *)buf, len, 10);
+}
+
+HAL_StatusTypeDef ds3231_WriteTime(const ds3231_time_t *t){
+	uint8_t raw[7];
+	uint8_t reg;
+	ds3231_pack(t, raw);
+
+	/* Burst từ 0x00: ghi giây reset chuỗi đếm, 6 thanh ghi còn lại vào cùng
+	 * giao dịch (< 1 ms) nên không thể có rollover xen giữa -> không "rách" giờ */
+	if(HAL_I2C_Mem_Write(&hi2c1, DS3231_ADDRESS, ADDRESS_SEC, I2C_MEMADD_SIZE_8BIT, raw, 7, 10) != HAL_OK){
+		return HAL_ERROR;
+	}
+
+	/* Đảm bảo dao động chạy: EOSC = 0, xoá cờ OSF (dừng dao động trước đó) */
+	if(HAL_I2C_Mem_Read(&hi2c1, DS3231_ADDRESS, ADDRESS_CONTROL, I2C_MEMADD_SIZE_8BIT, &reg, 1, 10) == HAL_OK && (reg & 0x80)){
+		reg &= (uint8_t)~0x80;
+		HAL_I2C_Mem_Write(&hi2c1, DS3231_ADDRESS, ADDRESS_CONTROL, I2C_MEMADD_SIZE_8BIT, &reg, 1, 10);
+	}
+	if(HAL_I2C_Mem_Read(&hi2c1, DS3231_ADDRESS, ADDRESS_STATUS, I2C_MEMADD_SIZE_8BIT, &reg, 1, 10) == HAL_OK && (reg & 0x80)){
+		reg &= (uint8_t)~0x80;
+		HAL_I2C_Mem_Write(&hi2c1, DS3231_ADDRESS, ADDRESS_STATUS, I2C_MEMADD_SIZE_8BIT, &reg, 1, 10);
+	}
+
+	/* Đọc lại để kiểm tra; chuỗi đếm vừa reset nên giây chưa thể nhảy */
+	if(HAL_I2C_Mem_Read(&hi2c1, DS3231_ADDRESS, ADDRESS_SEC, I2C_MEMADD_SIZE_8BIT, ds3231_buffer, 7, 10) != HAL_OK){
+		return HAL_ERROR;
+	}
+	for(int i = 0; i < 7; i++){
+		if((ds3231_buffer[i] & ds3231_time_mask[i]) != raw[i]) return HAL_ERROR;
+	}
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef ds3231_IntInit(void){
+	GPIO_InitTypeDef GPIO_InitStruct = {0};
+	/* Alarm2: A2M2 = A2M3 = A2M4 = 1 -> mỗi phút khi giây về 00 */
+	static const uint8_t a2_every_minute[3] = { 0x80, 0x80, 0x80 };
+	uint8_t ctrl_status[2];
+
+	if(HAL_I2C_Mem_Write(&hi2c1, DS3231_ADDRESS, 0x0B, I2C_MEMADD_SIZE_8BIT, (uint8_t*)a2_every_minute, 3, 10) != HAL_OK){
+		return HAL_ERROR;
+	}
+	/* Control: EOSC = 0, INTCN = 1, A2IE = 1; Status: xoá OSF/A1F/A2F */
+	ctrl_status[0] = ds3231_ctrl;
+	ctrl_status[1] = 0x00;
+	if(HAL_I2C_Mem_Write(&hi2c1, DS3231_ADDRESS, ADDRESS_CONTROL, I2C_MEMADD_SIZE_8BIT, ctrl_status, 2, 10) != HAL_OK){
+		return HAL_ERROR;
+	}
+
+	__HAL_RCC_GPIOB_CLK_ENABLE();   // RTC_SQW_GPIO_Port
+	GPIO_InitStruct.Pin = RTC_SQW_Pin;
+	GPIO_InitStruct.Mode = GPIO_MODE_IT_FALLING;
+	GPIO_InitStruct.Pull = GPIO_PULLUP;   // INT là open-drain
+	HAL_GPIO_Init(RTC_SQW_GPIO_Port, &GPIO_InitStruct);
+
+	HAL_NVIC_SetPriority(RTC_SQW_EXTI_IRQn, 1, 0);
+	HAL_NVIC_EnableIRQ(RTC_SQW_EXTI_IRQn);
+	return HAL_OK;
+}
+
+/* Đã đọc status (PendSV): ghi nhận cờ rồi xoá chúng */
+static void ds3231_status_done(HAL_StatusTypeDef status, const uint8_t *data, void *ctx){
+	uint8_t clr;
+	uint32_t primask;
+	(void)ctx;
+	if(status != HAL_OK){
+		ds3231_int_busy = 0;
+		return;
+	}
+	if(data[0] & DS3231_STAT_A1F) ds3231_a1_count++;
+	if(data[0] & DS3231_STAT_A2F){
+		/* Mốc 64-bit do EXTI (mức 1) ghi, PendSV đọc thành hai lần 32-bit: chặn
+		 * ngắt để không lấy nửa cũ nửa mới (khôi phục PRIMASK, không bật lại) */
+		primask = __get_PRIMASK();
+		__disable_irq();
+		ds3231_a2_stamp_us = ds3231_int_stamp_us;
+		ds3231_a2_count++;
+		__set_PRIMASK(primask);
+	}
+	/* Chỉ xoá cờ đã thấy: ghi 1 vào A1F/A2F không đổi gì, nên cờ vừa bật sau
+	 * lần đọc (A1 trùng mốc phút hh:mm:00) còn nguyên, INT vẫn thấp và
+	 * ds3231_Service đọc lại */
+	clr = data[0] ^ (DS3231_STAT_A1F | DS3231_STAT_A2F);
+	ds3231_WriteAsync(ADDRESS_STATUS, &clr, 1, NULL, NULL);
+	ds3231_int_busy = 0;
+}
+
+static void ds3231_read_status(void){
+	if(ds3231_int_busy) return;
+	ds3231_int_busy = 1;
+	if(ds3231_ReadAsync(ADDRESS_STATUS, 1, ds3231_status_done, NULL) != HAL_OK){
+		ds3231_int_busy = 0;
+	}
+}
+
+/* Phần sau của ngắt INT: xếp giao dịch đọc status */
+static void ds3231_int_work(uint32_t arg){
+	(void)arg;
+	ds3231_read_status();
+}
+
+HAL_StatusTypeDef ds3231_SetAlarm1(const ds3231_alarm_t *a, uint8_t enable){
+	uint8_t regs[4];
+	uint32_t primask;
+	HAL_StatusTypeDef st = HAL_BUSY;
+	regs[0] = DEC2BCD(a->sec)  | ((a->mask & DS3231_A1M1) ? 0x80 : 0);
+	regs[1] = DEC2BCD(a->min)  | ((a->mask & DS3231_A1M2) ? 0x80 : 0);
+	regs[2] = DEC2BCD(a->hour) | ((a->mask & DS3231_A1M3) ? 0x80 : 0);
+	regs[3] = DEC2BCD(a->day_date ? a->day_date : 1)
+	        | ((a->mask & DS3231_A1M4) ? 0x80 : 0)
+	        | ((a->mask & DS3231_A1_DY) ? 0x40 : 0);
+	primask = __get_PRIMASK();
+	__disable_irq();   // thanh ghi hẹn và A1IE vào hàng cùng nhau hoặc không cái nào
+	if(ds3231_queue_free() >= 2){
+		if(enable) ds3231_ctrl |= DS3231_CTRL_A1IE;
+		else       ds3231_ctrl &= (uint8_t)~DS3231_CTRL_A1IE;
+		ds3231_enqueue(0x07, regs, 4, 1, NULL, NULL);
+		st = ds3231_enqueue(ADDRESS_CONTROL, &ds3231_ctrl, 1, 1, NULL, NULL);
+	}
+	__set_PRIMASK(primask);
+	if(st == HAL_OK) ds3231_start_next();
+	return st;
+}
+
+uint32_t ds3231_TakeAlarm1(void){
+	uint32_t now = ds3231_a1_count;   // đọc 32-bit là nguyên tử trên M4
+	uint32_t n = now - ds3231_a1_taken;
+	ds3231_a1_taken = now;
+	return n;
+}
+
+uint32_t ds3231_TakeMinute(uint64_t *edge_us){
+	uint32_t now, n, primask;
+	uint64_t stamp;
+	primask = __get_PRIMASK();
+	__disable_irq();   // cặp (số lần, mốc 64-bit) phải nhất quán
+	now = ds3231_a2_count;
+	stamp = ds3231_a2_stamp_us;
+	__set_PRIMASK(primask);
+	n = now - ds3231_a2_taken;
+	ds3231_a2_taken = now;
+	if(edge_us) *edge_us = stamp;
+	return n;
 }
 
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin){
+	if(GPIO_Pin == RTC_SQW_Pin){
+		/* Cạnh INT luôn rơi đúng lúc giây tăng: đóng dấu ngay, phân loại sau */
+		ds3231_int_stamp_us = lclock_mono_us();
+		if(workq_post(ds3231_int_work, 0) != HAL_OK) ds3231_read_status();
+	}
+}
+
+/* ===== Driver bất đồng bộ ===== */
+/* Bỏ giao dịch đang chạy khỏi hàng; NULL nếu không có */
+static ds3231_req_t *ds3231_retire(void){
+	ds3231_req_t *r = NULL;
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	if(ds3231_active){
+		r = &ds3231_queue[ds3231_q_head & (DS3231_QUEUE_LEN - 1)];
+		ds3231_active = 0;
+		ds3231_q_head++;
+	}
+	__set_PRIMASK(primask);
+	return r;
+}
+
+/* Nhận phần tử đầu hàng trong vùng khoá, khởi động nó sau khi mở khoá.
+ * Mọi độ dài đều dùng IT: bản DMA của HAL gửi địa chỉ thanh ghi bằng vòng chờ
+ * cờ (I2C_TIMEOUT_FLAG 35 ms), bản IT làm cả pha đó trong ngắt sự kiện */
+static void ds3231_start_next(void){
+	ds3231_req_t *r;
+	HAL_StatusTypeDef st;
+	uint32_t primask;
+	for(;;){
+		primask = __get_PRIMASK();
+		__disable_irq();
+		/* callback có thể đã xếp và khởi động giao dịch mới */
+		if(ds3231_active || ds3231_held || ds3231_q_head == ds3231_q_tail){
+			__set_PRIMASK(primask);
+			return;
+		}
+		r = &ds3231_queue[ds3231_q_head & (DS3231_QUEUE_LEN - 1)];
+		ds3231_active = 1;
+		ds3231_active_since = HAL_GetTick();
+		ds3231_active_us = lclock_mono_us();
+		__set_PRIMASK(primask);
+		TRACE(TRACE_I2C_START, r->reg | ((uint32_t)r->len << 8) | ((uint32_t)r->write << 16),
+		      (uint8_t)(ds3231_q_tail - ds3231_q_head));
+		st = r->write
+			? HAL_I2C_Mem_Write_IT(&hi2c1, DS3231_ADDRESS, r->reg, I2C_MEMADD_SIZE_8BIT, r->data, r->len)
+			: HAL_I2C_Mem_Read_IT(&hi2c1, DS3231_ADDRESS, r->reg, I2C_MEMADD_SIZE_8BIT, r->data, r->len);
+		if(st == HAL_OK) return;
+		/* Không khởi động được: báo lỗi, bỏ qua và thử phần tử kế */
+		ds3231_retire();
+		if(r->cb) r->cb(HAL_ERROR, r->data, r->ctx);
+	}
+}
+
+static void ds3231_finish(HAL_StatusTypeDef status){
+	ds3231_req_t *r = ds3231_retire();
+	if(!r) return;
+	if(r->cb) r->cb(status, r->data, r->ctx);
+	ds3231_start_next();
+}
+
+/* Chỉ xếp hàng; gọi với ngắt đã tắt, ds3231_start_next() sau khi mở */
+static HAL_StatusTypeDef ds3231_enqueue(uint8_t reg, const uint8_t *data, uint8_t len, uint8_t write,
+                                        ds3231_cb_t cb, void *ctx){
+	ds3231_req_t *r;
+	if(len == 0 || len > DS3231_XFER_MAX) return HAL_ERROR;
+	if(ds3231_queue_free() == 0) return HAL_BUSY;
+	r = &ds3231_queue[ds3231_q_tail & (DS3231_QUEUE_LEN - 1)];
+	r->reg = reg;
+	r->len = len;
+	r->write = write;
+	if(write) memcpy(r->data, data, len);
+	r->cb = cb;
+	r->ctx = ctx;
+	ds3231_q_tail++;
+	return HAL_OK;
+}
+
+static HAL_StatusTypeDef ds3231_submit(uint8_t reg, const uint8_t *data, uint8_t len, uint8_t write,
+                                       ds3231_cb_t cb, void *ctx){
+	HAL_StatusTypeDef st;
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	st = ds3231_enqueue(reg, data, len, write, cb, ctx);
+	__set_PRIMASK(primask);
+	if(st == HAL_OK) ds3231_start_next();
+	return st;
+}
+
+HAL_StatusTypeDef ds3231_ReadAsync(uint8_t reg, uint8_t len, ds3231_cb_t cb, void *ctx){
+	return ds3231_submit(reg, NULL, len, 0, cb, ctx);
+}
+
+HAL_StatusTypeDef ds3231_WriteAsync(uint8_t reg, const uint8_t *data, uint8_t len, ds3231_cb_t cb, void *ctx){
+	return ds3231_submit(reg, data, len, 1, cb, ctx);
+}
+
+uint8_t ds3231_Busy(void){
+	return ds3231_active || ds3231_q_head != ds3231_q_tail;
+}
+
+void ds3231_Hold(uint8_t hold){
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	ds3231_held = hold;
+	__set_PRIMASK(primask);
+	if(!hold) ds3231_start_next();
+}
+
+void ds3231_Service(void){
+	ds3231_req_t *r;
+	/* INT vẫn thấp (cờ chưa xoá được) -> không còn cạnh xuống, tự đọc lại */
+	if(HAL_GPIO_ReadPin(RTC_SQW_GPIO_Port, RTC_SQW_Pin) == GPIO_PIN_RESET){
+		if(HAL_GetTick() - ds3231_int_low_since >= DS3231_INT_STUCK_MS){
+			ds3231_int_low_since = HAL_GetTick();
+			ds3231_read_status();
+		}
+	} else {
+		ds3231_int_low_since = HAL_GetTick();
+	}
+
+	if(!ds3231_active) return;
+	if(HAL_GetTick() - ds3231_active_since < DS3231_XFER_TIMEOUT) return;
+	/* Treo: giữ hàng, huỷ giao dịch (chỉ phần này cần khoá), khởi tạo lại
+	 * ngoại vi với ngắt bật như clk_reinit_buses rồi chạy tiếp hàng đợi.
+	 * Ngắt hoàn tất muộn của giao dịch cũ bị ds3231_finish_work bỏ qua */
+	DLOG("ds3231: giao dịch treo %u ms, khởi tạo lại I2C", HAL_GetTick() - ds3231_active_since);
+	ds3231_Hold(1);
+	r = ds3231_retire();
+	HAL_I2C_DeInit(&hi2c1);
+	HAL_I2C_Init(&hi2c1);
+	if(r && r->cb) r->cb(HAL_TIMEOUT, r->data, r->ctx);
+	ds3231_Hold(0);
+}
+
+/* Kết thúc giao dịch: ISR I2C/DMA chỉ chuyển việc sang PendSV (giải mã, callback,
+ * khởi động giao dịch kế). arg mang cả head để bỏ qua nếu Service đã huỷ giao dịch */
+static void ds3231_finish_work(uint32_t arg){
+	if(ds3231_active && (uint8_t)(arg >> 8) == ds3231_q_head)
+		ds3231_finish((HAL_StatusTypeDef)(arg & 0xFF));
+}
+
+static void ds3231_complete(HAL_StatusTypeDef status){
+	uint32_t arg = ((uint32_t)ds3231_q_head << 8) | (uint32_t)status;
+	TRACE(TRACE_I2C_DONE, status, ds3231_q_head);
+	if(workq_post(ds3231_finish_work, arg) != HAL_OK) ds3231_finish(status);
+}
+
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c){
+	if(hi2c->Instance == I2C1) ds3231_complete(HAL_OK);
+}
+
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c){
+	if(hi2c->Instance == I2C1) ds3231_complete(HAL_OK);
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c){
+	if(hi2c->Instance == I2C1) ds3231_complete(HAL_ERROR);
+}
+
+/* ===== Snapshot thời gian ===== */
+static void ds3231_publish(const uint8_t *raw){
+	PROF_ENTER(ds3231_publish);
+	ds3231_snap_seq++;				// lẻ: đang ghi
+	__DMB();
+	ds3231_unpack(raw, &ds3231_snap);
+	ds3231_snap_us = ds3231_active_us;
+	__DMB();
+	ds3231_snap_seq++;				// chẵn: nhất quán
+	PROF_EXIT(ds3231_publish);
+}
+
+static void ds3231_time_done(HAL_StatusTypeDef status, const uint8_t *data, void *ctx){
+	(void)ctx;
+	if(status == HAL_OK) ds3231_publish(data);
+}
+
+static void ds3231_verify_done(HAL_StatusTypeDef status, const uint8_t *data, void *ctx){
+	uint8_t raw[7];
+	(void)ctx;
+	if(status != HAL_OK){
+		ds3231_verify_errors++;
+		DLOG("ds3231: đọc lại sau khi ghi lỗi %u", status);
+		return;
+	}
+	ds3231_pack(&ds3231_pending_write, raw);
+	for(int i = 0; i < 7; i++){
+		if((data[i] & ds3231_time_mask[i]) != raw[i]){
+			ds3231_verify_errors++;
+			DLOG("ds3231: đọc lại sai ở reg %u: 0x%02x, muốn 0x%02x", i, data[i], raw[i]);
+			break;
+		}
+	}
+	ds3231_publish(data);
+}
+
+HAL_StatusTypeDef ds3231_RequestTime(void){
+	return ds3231_ReadAsync(ADDRESS_SEC, 7, ds3231_time_done, NULL);
+}
+
+HAL_StatusTypeDef ds3231_WriteTimeAsync(const ds3231_time_t *t){
+	uint8_t raw[7];
+	/* Control giữ nguyên (EOSC = 0); Status = 0x00: xoá OSF, A1F, A2F */
+	uint8_t ctrl_status[2];
+	uint32_t primask;
+	HAL_StatusTypeDef st = HAL_BUSY;
+	ctrl_status[0] = ds3231_ctrl;
+	ctrl_status[1] = 0x00;
+	ds3231_pack(t, raw);
+	/* Ghi giờ không được đi một mình thiếu bản đọc lại: đủ 3 chỗ mới xếp */
+	primask = __get_PRIMASK();
+	__disable_irq();
+	if(ds3231_queue_free() >= 3){
+		ds3231_pending_write = *t;
+		ds3231_enqueue(ADDRESS_SEC, raw, 7, 1, NULL, NULL);
+		ds3231_enqueue(ADDRESS_CONTROL, ctrl_status, 2, 1, NULL, NULL);
+		st = ds3231_enqueue(ADDRESS_SEC, NULL, 7, 0, ds3231_verify_done, NULL);
+	}
+	__set_PRIMASK(primask);
+	if(st == HAL_OK) ds3231_start_next();
+	return st;
+}
+
+uint8_t ds3231_TakeTime(ds3231_time_t *t, uint64_t *at_us){
+	uint32_t s1, s2;
+	do {
+		s1 = ds3231_snap_seq;
+		__DMB();
+		*t = ds3231_snap;
+		if(at_us) *at_us = ds3231_snap_us;
+		__DMB();
+		s2 = ds3231_snap_seq;
+	} while((s1 & 1u) || s1 != s2);
+	if(s1 == ds3231_snap_taken) return 0;
+	ds3231_snap_taken = s1;
+	return 1;
+}
@@ -6,12 +6,16 @@
 #include "main.h"     // HAL_GPIO_WritePin, HAL_Delay, __IO, pin aliases
 #include "lcd.h"
 #include "lcdfont.h"
+#include "prof.h"
 #include <stdint.h>
 
 unsigned char s[50];
 
 _lcd_dev lcddev;
 
+PROF_ZONE(lcd_Fill);
+PROF_ZONE(lcd_ShowChar);
+
 /* =================== Low-level =================== */
 void LCD_WR_REG(uint16_t reg)
 {
@@ -98,12 +102,14 @@ void lcd_Clear(uint16_t color)
 void lcd_Fill(uint16_t xsta, uint16_t ysta, uint16_t xend, uint16_t yend, uint16_t color)
 {
   uint16_t i, j;
+  PROF_ENTER(lcd_Fill);
   lcd_AddressSet(xsta, ysta, xend - 1, yend - 1);
   for (i = ysta; i < yend; i++) {
     for (j = xsta; j < xend; j++) {
       LCD_WR_DATA(color);
     }
   }
+  PROF_EXIT(lcd_Fill);
 }
 
 void lcd_DrawPoint(uint16_t x, uint16_t y, uint16_t color)
@@ -151,6 +157,7 @@ void lcd_ShowChar(uint16_t x, uint16_t y, uint8_t num, uint16_t fc, uint16_t bc,
   uint8_t temp, sizex, t, m = 0;
   uint16_t i, TypefaceNum;
   uint16_t x0 = x;
+  PROF_ENTER(lcd_ShowChar);
   sizex = sizey / 2;
   TypefaceNum = (sizex / 8 + ((sizex % 8) ? 1 : 0)) * sizey;
   num = num - ' ';
@@ -161,7 +168,7 @@ void lcd_ShowChar(uint16_t x, uint16_t y, uint8_t num, uint16_t fc, uint16_t bc,
     else if (sizey == 16) temp = ascii_1608[num][i];
     else if (sizey == 24) temp = ascii_2412[num][i];
     else if (sizey == 32) temp = ascii_3216[num][i];
-    else return;
+    else break;   // cỡ chữ không có font
 
     for (t = 0; t < 8; t++) {
       if (!mode) {
@@ -176,6 +183,7 @@ void lcd_ShowChar(uint16_t x, uint16_t y, uint8_t num, uint16_t fc, uint16_t bc,
       }
     }
   }
+  PROF_EXIT(lcd_ShowChar);
 }
 
 uint32_t mypow(uint8_t m, uint8_t n)
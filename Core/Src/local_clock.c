@@ -0,0 +1,155 @@
+/*
+ * local_clock.c
+ *
+ *  Đồng hồ phần mềm bám theo DS3231:
+ *    rtc = mốc_rtc + dt * (1 + rate) + slew,  dt = mono - mốc_mono
+ *  rate đo từ khoảng cách giữa các mốc (FLL), lỗi pha được rải dần (slew)
+ *  để giờ luôn đơn điệu, không nhảy lùi.
+ */
+#include "local_clock.h"
+#include "software_timer.h"
+#include "dlog.h"
+
+#define LCLOCK_STEP_US        1000000   // lệch quá 1 s -> đặt lại thẳng, không slew
+#define LCLOCK_SLEW_PPM       5000      // tốc độ bù pha tối đa (5 ms mỗi giây)
+#define LCLOCK_FIRST_SPAN_US  10000000  // lần đo đầu: HSI lệch tới 1%, cần sớm nhưng mốc còn thô
+#define LCLOCK_MIN_SPAN_US    16000000  // sau đó đo trên khoảng >= 16 s cho ít nhiễu
+#define LCLOCK_FLL_DIV        4         // lọc tần số: mỗi lần đo chỉnh 1/4 sai khác
+
+static uint64_t anchor_mono_us;
+static int64_t  anchor_rtc_us;
+static int32_t  rate_ppb;
+static int32_t  slew_us;
+static int32_t  last_offset_us;
+
+static uint64_t span_mono_us;      // mốc bắt đầu khoảng đo tần số
+static int64_t  span_rtc_us;
+static bool     span_valid;
+static bool     rate_valid;
+static bool     synced;
+
+void lclock_init(void){
+	anchor_mono_us = 0;
+	anchor_rtc_us = 0;
+	rate_ppb = 0;
+	slew_us = 0;
+	last_offset_us = 0;
+	rate_valid = false;
+	span_valid = false;
+	synced = false;
+}
+
+/* TIM2 1 MHz: đếm cả khi CPU ngủ (WFI), đọc không phụ thuộc ISR SysTick */
+uint64_t lclock_mono_us(void){
+	return timer_now_us();
+}
+
+static int64_t estimate_at(uint64_t mono){
+	int64_t dt = (int64_t)(mono - anchor_mono_us);
+	int64_t t = anchor_rtc_us + dt + dt * rate_ppb / 1000000000LL;
+	int64_t slew_max = dt * LCLOCK_SLEW_PPM / 1000000;
+	if(slew_us >= 0) t += (slew_us < slew_max) ? slew_us : slew_max;
+	else             t -= (-slew_us < slew_max) ? -slew_us : slew_max;
+	return t;
+}
+
+/* Mốc đặt lại thường thô (điểm giữa hai lần đọc, sai tới vài chục ms):
+ * không dùng làm gốc đo tần số, chờ mốc discipline kế */
+static void restart(int64_t ref_us, uint64_t mono_us){
+	anchor_mono_us = mono_us;
+	anchor_rtc_us = ref_us;
+	slew_us = 0;
+	span_valid = false;
+}
+
+void lclock_discipline(uint32_t rtc_sec, uint64_t mono_us){
+	int64_t ref = (int64_t)rtc_sec * 1000000;
+	int64_t est, err, span;
+
+	if(!synced){
+		restart(ref, mono_us);
+		synced = true;
+		return;
+	}
+
+	est = estimate_at(mono_us);
+	err = ref - est;
+	last_offset_us = (int32_t)err;
+	if(err > LCLOCK_STEP_US || err < -LCLOCK_STEP_US){
+		restart(ref, mono_us);
+		return;
+	}
+
+	/* Tần số: so độ dài khoảng theo RTC (số giây nguyên) với khoảng mono */
+	span = (int64_t)(mono_us - span_mono_us);
+	if(!span_valid){
+		span_mono_us = mono_us;
+		span_rtc_us = ref;
+		span_valid = true;
+	} else if(span >= (rate_valid ? LCLOCK_MIN_SPAN_US : LCLOCK_FIRST_SPAN_US)){
+		int32_t meas = (int32_t)(((ref - span_rtc_us) - span) * 1000000000LL / span);
+		if(!rate_valid){
+			rate_ppb = meas;
+			rate_valid = true;
+		} else {
+			rate_ppb += (meas - rate_ppb) / LCLOCK_FLL_DIV;
+		}
+		DLOG("lclock: đo %d ppb qua %u ms, tần số %d ppb", meas, (uint32_t)(span / 1000), rate_ppb);
+		span_mono_us = mono_us;
+		span_rtc_us = ref;
+	}
+
+	/* Giữ liên tục tại mốc mới, phần lỗi pha còn lại được slew dần */
+	anchor_mono_us = mono_us;
+	anchor_rtc_us = est;
+	slew_us = (int32_t)err;
+}
+
+bool lclock_synced(void){
+	return synced;
+}
+
+void lclock_invalidate_phase(void){
+	synced = false;
+}
+
+bool lclock_rate_valid(void){
+	return rate_valid;
+}
+
+uint64_t lclock_to_rtc_us(uint64_t mono_us){
+	int64_t t = estimate_at(mono_us);
+	return (t > 0) ? (uint64_t)t : 0;
+}
+
+uint64_t lclock_now_us(void){
+	return lclock_to_rtc_us(lclock_mono_us());
+}
+
+uint64_t lclock_now_ms(void){
+	return lclock_now_us() / 1000u;
+}
+
+uint16_t lclock_ms_since_second(void){
+	return (uint16_t)(lclock_now_us() % 1000000u / 1000u);
+}
+
+uint64_t lclock_next_second_mono(uint32_t *sec){
+	uint64_t mono = lclock_mono_us();
+	uint64_t now = lclock_to_rtc_us(mono);
+	uint64_t next = (now / 1000000u + 1u) * 1000000u;
+	/* Dự đoán tuyến tính rồi sửa một lần: trong lúc slew, tốc độ RTC/mono
+	 * lệch tới SLEW_PPM nên một bước có thể sai vài ms */
+	mono += next - now;
+	mono += (int64_t)(next - lclock_to_rtc_us(mono));
+	if(sec) *sec = (uint32_t)(next / 1000000u);
+	return mono;
+}
+
+int32_t lclock_rate_ppb(void){
+	return rate_ppb;
+}
+
+int32_t lclock_offset_us(void){
+	return last_offset_us;
+}
@@ -22,6 +22,14 @@
 #include "software_timer.h"
 #include "button.h"
 #include "app_clock.h"
+#include "sched.h"
+#include "workq.h"
+#include "clock_gov.h"
+#include "prof.h"
+#include "bench.h"
+#include "trace.h"
+#include "dlog.h"
+#include "stack_mon.h"
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
 
@@ -57,6 +65,7 @@
 /* Private function prototypes -----------------------------------------------*/
 void SystemClock_Config(void);
 static void MX_GPIO_Init(void);
+static void MX_DMA_Init(void);
 static void MX_FSMC_Init(void);
 static void MX_I2C1_Init(void);
 static void MX_SPI1_Init(void);
@@ -77,7 +86,7 @@ static void MX_TIM2_Init(void);
 int main(void)
 {
   /* USER CODE BEGIN 1 */
-
+  stack_paint();        // trước mọi ngắt: tô vùng stack để đo mức sâu nhất
   /* USER CODE END 1 */
 
   /* MCU Configuration--------------------------------------------------------*/
@@ -98,11 +107,16 @@ int main(void)
 
   /* Initialize all configured peripherals */
   MX_GPIO_Init();
+  MX_DMA_Init();
   MX_FSMC_Init();
   MX_I2C1_Init();
   MX_SPI1_Init();
   MX_TIM2_Init();
   /* USER CODE BEGIN 2 */
+  prof_init();          // DWT CYCCNT (chỉ bản DEBUG)
+  trace_init();         // vòng vết sự kiện (chỉ bản DEBUG)
+  dlog_init();          // log định dạng hoãn (chỉ bản DEBUG)
+  workq_init();         // trước mọi ngắt có phần xử lý hoãn (I2C, EXTI, SPI)
   lcd_init();
 
   ds3231_init();
@@ -110,8 +124,12 @@ int main(void)
   button_init();
 
   timer_init();
-  app_clock_init();
-  setTimer2(50);        // ví dụ
+  clk_gov_init();       // sau timer_init: đổi clock cần TIM2 đang chạy
+  if (bench_requested()) bench_run();   // giữ OK lúc bật: đo trên chip, phím bất kỳ để vào đồng hồ
+  sched_init();
+  app_clock_init();     // đăng ký task: quét nút 100 Hz, logic 50 Hz, vẽ khi cần, RTC 1 Hz
+  sched_run();          // lượt đầu: vẽ cả màn hình
+  sched_reset_stats();  // quá tải lúc khởi động không tính vào số hiện ở VIEW
   /* USER CODE END 2 */
 
   /* Infinite loop */
@@ -119,11 +137,16 @@ int main(void)
   while (1)
   {
     /* USER CODE END WHILE */
-	  while (!flag_timer2);
-	  flag_timer2 = 0;
-
-	  button_Scan();        // <— QUAN TRỌNG: cập nhật button_count[16]
-	  app_clock_on_tick();
+	  clk_gov_idle();              // rảnh đủ lâu: tắt PLL, chạy HSI 16 MHz
+	  timer_sleep_until_event();   // WFI, không quay bận
+	  stimer_process();            // timer hết hạn chạy ở đây, không trong ISR
+	  if (flag_oneshot) {
+		  flag_oneshot = 0;
+		  app_clock_on_second();
+	  }
+	  sched_run();                 // các task đến lượt, theo ưu tiên
+	  dlog_flush();                // log nhị phân ra _write khi rảnh
+	  stack_check();               // mỗi giây: mức stack sâu nhất
     /* USER CODE BEGIN 3 */
   }
   /* USER CODE END 3 */
@@ -189,7 +212,7 @@ static void MX_I2C1_Init(void)
 
   /* USER CODE END I2C1_Init 1 */
   hi2c1.Instance = I2C1;
-  hi2c1.Init.ClockSpeed = 100000;
+  hi2c1.Init.ClockSpeed = 400000;
   hi2c1.Init.DutyCycle = I2C_DUTYCYCLE_2;
   hi2c1.Init.OwnAddress1 = 0;
   hi2c1.Init.AddressingMode = I2C_ADDRESSINGMODE_7BIT;
@@ -259,14 +282,15 @@ static void MX_TIM2_Init(void)
 
   TIM_ClockConfigTypeDef sClockSourceConfig = {0};
   TIM_MasterConfigTypeDef sMasterConfig = {0};
+  TIM_OC_InitTypeDef sConfigOC = {0};
 
   /* USER CODE BEGIN TIM2_Init 1 */
 
   /* USER CODE END TIM2_Init 1 */
   htim2.Instance = TIM2;
-  htim2.Init.Prescaler = 840-1;
+  htim2.Init.Prescaler = 84-1;
   htim2.Init.CounterMode = TIM_COUNTERMODE_UP;
-  htim2.Init.Period = 100-1;
+  htim2.Init.Period = 4294967295;
   htim2.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
   htim2.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
   if (HAL_TIM_Base_Init(&htim2) != HAL_OK)
@@ -278,18 +302,54 @@ static void MX_TIM2_Init(void)
   {
     Error_Handler();
   }
+  if (HAL_TIM_OC_Init(&htim2) != HAL_OK)
+  {
+    Error_Handler();
+  }
   sMasterConfig.MasterOutputTrigger = TIM_TRGO_RESET;
   sMasterConfig.MasterSlaveMode = TIM_MASTERSLAVEMODE_DISABLE;
   if (HAL_TIMEx_MasterConfigSynchronization(&htim2, &sMasterConfig) != HAL_OK)
   {
     Error_Handler();
   }
+  sConfigOC.OCMode = TIM_OCMODE_TIMING;
+  sConfigOC.Pulse = 1000;
+  sConfigOC.OCPolarity = TIM_OCPOLARITY_HIGH;
+  sConfigOC.OCFastMode = TIM_OCFAST_DISABLE;
+  if (HAL_TIM_OC_ConfigChannel(&htim2, &sConfigOC, TIM_CHANNEL_1) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  sConfigOC.Pulse = 0;
+  if (HAL_TIM_OC_ConfigChannel(&htim2, &sConfigOC, TIM_CHANNEL_2) != HAL_OK)
+  {
+    Error_Handler();
+  }
   /* USER CODE BEGIN TIM2_Init 2 */
 
   /* USER CODE END TIM2_Init 2 */
 
 }
 
+/**
+  * Enable DMA controller clock
+  */
+static void MX_DMA_Init(void)
+{
+
+  /* DMA controller clock enable */
+  __HAL_RCC_DMA1_CLK_ENABLE();
+
+  /* DMA interrupt init */
+  /* DMA1_Stream0_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA1_Stream0_IRQn, 1, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Stream0_IRQn);
+  /* DMA1_Stream6_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA1_Stream6_IRQn, 1, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Stream6_IRQn);
+
+}
+
 /**
   * @brief GPIO Initialization Function
   * @param None
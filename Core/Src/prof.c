@@ -0,0 +1,81 @@
+/*
+ * prof.c
+ */
+#include "prof.h"
+
+#if PROF_ENABLE
+#include <stdio.h>
+
+static prof_zone_t *prof_head = 0;
+
+void prof_init(void){
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/* Vùng có thể được vào lần đầu từ ISR: móc với ngắt tắt */
+void prof_link(prof_zone_t *z){
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	if(!z->linked){
+		z->next = prof_head;
+		prof_head = z;
+		z->linked = 1;
+	}
+	__set_PRIMASK(primask);
+}
+
+void prof_exit(prof_zone_t *z, uint32_t t0){
+	uint32_t dt = DWT->CYCCNT - t0;		// tràn 32 bit vẫn đúng (< 25 s ở 168 MHz)
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	z->count++;
+	z->total += dt;
+	if(dt < z->min) z->min = dt;
+	if(dt > z->max) z->max = dt;
+	__set_PRIMASK(primask);
+}
+
+uint8_t prof_snapshot(prof_stat_t *out, uint8_t max){
+	uint8_t n = 0;
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	for(prof_zone_t *z = prof_head; z && n < max; z = z->next, n++){
+		out[n].name = z->name;
+		out[n].count = z->count;
+		out[n].min = z->count ? z->min : 0;
+		out[n].max = z->max;
+		out[n].total = z->total;
+	}
+	__set_PRIMASK(primask);
+	return n;
+}
+
+void prof_reset(void){
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	for(prof_zone_t *z = prof_head; z; z = z->next){
+		z->count = 0;
+		z->min = 0xFFFFFFFFu;
+		z->max = 0;
+		z->total = 0;
+	}
+	__set_PRIMASK(primask);
+}
+
+void prof_dump(void (*put)(const char *line)){
+	prof_stat_t st[16];
+	char line[80];
+	uint8_t n = prof_snapshot(st, 16);
+	put("zone                 count        min        avg        max (cyc)\r\n");
+	for(uint8_t i = 0; i < n; i++){
+		snprintf(line, sizeof(line), "%-16s %9lu %10lu %10lu %10lu\r\n", st[i].name,
+		         (unsigned long)st[i].count, (unsigned long)st[i].min,
+		         (unsigned long)(st[i].count ? st[i].total / st[i].count : 0),
+		         (unsigned long)st[i].max);
+		put(line);
+	}
+}
+
+#endif
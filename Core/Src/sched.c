@@ -0,0 +1,176 @@
+/*
+ * sched.c
+ */
+#include "sched.h"
+#include "software_timer.h"
+#include "trace.h"
+
+static task_t  *tasks[SCHED_MAX_TASKS];		// sắp theo prio tăng dần
+static uint8_t  task_n = 0;
+static stimer_t sched_timer;				// đánh thức vòng chính
+static volatile uint8_t sched_wake = 0;
+static uint32_t sched_busy_max = 0;
+
+/* Hẹn lần phát hành sớm nhất (task sự kiện chưa kick thì không tính) */
+static void sched_arm(void){
+	uint64_t next = UINT64_MAX, now;
+	for(uint8_t i = 0; i < task_n; i++){
+		if(tasks[i]->event && !tasks[i]->pending) continue;
+		if(tasks[i]->release_us < next) next = tasks[i]->release_us;
+	}
+	if(next == UINT64_MAX){
+		stimer_stop(&sched_timer);
+	} else {
+		now = timer_now_us();
+		/* Wheel theo ms: làm tròn lên để không dậy sớm rồi ngủ lại */
+		stimer_start(&sched_timer, (next > now) ? (uint32_t)((next - now + 999u) / 1000u) : 0, 0);
+	}
+}
+
+/* Lưới tuyệt đối theo chu kỳ: các task có chu kỳ bội nhau dậy cùng một lần */
+static uint64_t next_grid(uint64_t now, uint32_t period_us){
+	return (now / period_us + 1u) * period_us;
+}
+
+void sched_init(void){
+	task_n = 0;
+	stimer_init_flag(&sched_timer, &sched_wake);
+}
+
+bool sched_add(task_t *t){
+	uint8_t i;
+	if(task_n >= SCHED_MAX_TASKS || !t->fn || !t->period_us) return false;
+	t->release_us = t->event ? timer_now_us() : next_grid(timer_now_us(), t->period_us);
+	t->pending = false;
+	i = task_n++;
+	while(i > 0 && tasks[i - 1]->prio > t->prio){
+		tasks[i] = tasks[i - 1];
+		i--;
+	}
+	tasks[i] = t;
+	sched_arm();		// vòng chính ngủ trước lần sched_run đầu: phải có hẹn ngay
+	return true;
+}
+
+void sched_set_period(task_t *t, uint32_t period_us){
+	if(!period_us || t->period_us == period_us) return;
+	t->period_us = period_us;
+	if(!t->event) t->release_us = next_grid(timer_now_us(), period_us);
+	sched_arm();
+}
+
+void sched_kick(task_t *t){
+	t->pending = true;
+}
+
+static bool task_ready(const task_t *t, uint64_t now){
+	if(t->event && !t->pending) return false;
+	return now >= t->release_us;
+}
+
+static uint8_t hist_bin(uint32_t us){
+	uint8_t b = 0;
+	us /= SCHED_HIST_BASE_US;
+	while(us && b < SCHED_HIST_BINS - 1){
+		us >>= 1;
+		b++;
+	}
+	return b;
+}
+
+static inline void hist_add(uint16_t *h, uint32_t us){
+	uint8_t b = hist_bin(us);
+	if(h[b] != 0xFFFF) h[b]++;
+}
+
+static void task_exec(task_t *t, uint64_t now){
+	uint64_t release = t->release_us;
+	uint32_t deadline = t->deadline_us ? t->deadline_us : t->period_us;
+	uint64_t end;
+	uint32_t exec, lat;
+
+	/* Task sự kiện: mốc tính từ lúc được phép chạy sớm nhất */
+	if(t->event){
+		t->pending = false;
+		release = now;
+	}
+	lat = (uint32_t)(now - release);
+	if(lat > t->max_latency_us) t->max_latency_us = lat;
+	hist_add(t->latency_hist, lat);
+
+	TRACE(TRACE_TASK, trace_tag(t->name), lat);
+	t->fn();
+
+	end = timer_now_us();
+	exec = (uint32_t)(end - now);
+	TRACE(TRACE_TASK_END, trace_tag(t->name), exec);
+	t->runs++;
+	t->last_exec_us = exec;
+	t->total_exec_us += exec;
+	if(exec > t->max_exec_us) t->max_exec_us = exec;
+	hist_add(t->exec_hist, exec);
+	if(end - release > deadline) t->misses++;
+
+	if(t->event){
+		t->release_us = now + t->period_us;		// giãn cách tối thiểu
+	} else {
+		t->release_us = release + t->period_us;
+		/* Quá tải: bỏ các lượt đã lỡ, giữ lưới chu kỳ */
+		while(t->release_us <= end){
+			t->release_us += t->period_us;
+			t->skipped++;
+		}
+	}
+}
+
+void sched_run(void){
+	uint64_t now;
+	uint8_t i;
+
+	uint64_t start = timer_now_us();
+
+	sched_wake = 0;
+	for(;;){
+		now = timer_now_us();
+		for(i = 0; i < task_n && !task_ready(tasks[i], now); i++);
+		if(i == task_n) break;
+		task_exec(tasks[i], now);
+	}
+	if((uint32_t)(now - start) > sched_busy_max) sched_busy_max = (uint32_t)(now - start);
+	sched_arm();
+}
+
+uint32_t sched_overruns(void){
+	uint32_t n = 0;
+	for(uint8_t i = 0; i < task_n; i++) n += tasks[i]->misses + tasks[i]->skipped;
+	return n;
+}
+
+uint32_t sched_max_busy_us(void){
+	return sched_busy_max;
+}
+
+uint8_t sched_task_count(void){
+	return task_n;
+}
+
+task_t *sched_task(uint8_t i){
+	return (i < task_n) ? tasks[i] : 0;
+}
+
+void sched_reset_stats(void){
+	for(uint8_t i = 0; i < task_n; i++){
+		tasks[i]->runs = 0;
+		tasks[i]->misses = 0;
+		tasks[i]->skipped = 0;
+		tasks[i]->last_exec_us = 0;
+		tasks[i]->max_exec_us = 0;
+		tasks[i]->total_exec_us = 0;
+		tasks[i]->max_latency_us = 0;
+		for(uint8_t b = 0; b < SCHED_HIST_BINS; b++){
+			tasks[i]->exec_hist[b] = 0;
+			tasks[i]->latency_hist[b] = 0;
+		}
+	}
+	sched_busy_max = 0;
+}
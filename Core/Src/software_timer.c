@@ -7,30 +7,375 @@
 
 #include "software_timer.h"
 #define TIMER_CYCLE_2 1
+#define TIMER_MAX_SLEEP_US 1000000u	// CC1 tối đa 1 s/lần khi không có hạn nào
 
+/* Tickless: TIM2 chạy tự do 1 MHz, CC1 được nạp đúng hạn gần nhất
+ * (flag_timer2 hoặc timing wheel). Thời gian trôi đọc từ CNT nên không trôi
+ * dù ngắt đến muộn hay thưa. */
+volatile uint16_t flag_timer2 = 0;
+static uint64_t timer2_next_us = 0;		// hạn flag_timer2 kế tiếp
+static uint32_t timer2_period_us = 0;	// 0 = tắt
+volatile uint32_t timer2_missed = 0;	// nhịp bị nuốt: cờ chưa xử lý hoặc ngắt trễ quá chu kỳ
+static uint8_t  tick_from_tim2 = 0;		// HAL_GetTick đọc TIM2, SysTick đã dừng
 
-uint16_t flag_timer2 = 0;
-uint16_t timer2_counter = 0;
-uint16_t timer2_MUL = 0;
+/* CC2: báo thức một lần tại thời điểm µs bất kỳ */
+volatile uint16_t flag_oneshot = 0;
+static volatile uint8_t oneshot_armed = 0;
+
+/* ============ Timing wheel ============
+ * 4 tầng x 64 ô (ms, 64 ms, 4 s, 4.6 phút mỗi ô) phủ ~4.6 giờ; xa hơn thì
+ * nằm ô cuối và được xếp lại khi tới. ISR chỉ so một mốc; chèn/xoá là
+ * O(1), hết hạn được xử lý ở vòng chính (stimer_process). Mỗi tầng có một
+ * bitmap 64 bit các ô khác rỗng: ô kế tiếp tìm bằng một lệnh CTZ, nên cả
+ * hết hạn lẫn hẹn lại mốc đánh thức theo số sự kiện, không theo số ô. */
+#define STIMER_BITS   6
+#define STIMER_SLOTS  (1u << STIMER_BITS)
+#define STIMER_MASK   (STIMER_SLOTS - 1u)
+#define STIMER_LEVELS 4
+#define STIMER_SPAN   (1u << (STIMER_BITS * STIMER_LEVELS))
+
+static stimer_t *wheel[STIMER_LEVELS][STIMER_SLOTS];
+static uint64_t wheel_occ[STIMER_LEVELS];		// bit i: ô i khác rỗng
+static uint32_t wheel_now = 0;					// ms đã xử lý tới
+static uint32_t stimer_armed = 0;
+static volatile uint32_t stimer_wake_at = 0x7FFFFFFF;
+volatile uint16_t flag_stimer = 0;
+
+/* Đo thời gian ngủ: cửa sổ 1 s theo TIM2 */
+#define IDLE_WINDOW_US 1000000u
+volatile uint16_t cpu_idle_permille = 0;
+static uint32_t idle_acc_us = 0;
+static uint32_t idle_window_start = 0;
+
+/* Số lần CNT tràn 32 bit (~71.6 phút/lần) -> mở rộng thành 64 bit */
+static volatile uint32_t timer2_wraps = 0;
 
 void timer_init(){
-	HAL_TIM_Base_Start_IT(&htim2);
+	HAL_TIM_Base_Start_IT(&htim2);				// ngắt tràn
+	HAL_TIM_OC_Start_IT(&htim2, TIM_CHANNEL_1);	// hạn gần nhất (tickless)
+	HAL_TIM_OC_Start_IT(&htim2, TIM_CHANNEL_2);	// one-shot, chỉ bật ngắt khi hẹn
+	__HAL_TIM_DISABLE_IT(&htim2, TIM_IT_CC2);
+#ifdef DEBUG
+	DBGMCU->CR |= DBGMCU_CR_DBG_SLEEP;			// giữ kết nối debug khi WFI
+#endif
+	idle_window_start = TIM2->CNT;
+
+	/* Từ đây HAL_GetTick lấy từ TIM2; SysTick thôi ngắt 1 kHz */
+	tick_from_tim2 = 1;
+	HAL_SuspendTick();
+	timer_reprogram();
+}
+
+/* Ghi đè bản weak của HAL: ms từ TIM2 (trước timer_init vẫn là SysTick) */
+uint32_t HAL_GetTick(void){
+	if(tick_from_tim2) return (uint32_t)(timer_now_us() / 1000u);
+	return uwTick;
 }
 
 void setTimer2(uint16_t duration){
-	timer2_MUL = duration/TIMER_CYCLE_2;
-	timer2_counter = timer2_MUL;
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	timer2_period_us = (uint32_t)(duration / TIMER_CYCLE_2) * 1000u;
+	timer2_next_us = timer_now_us() + timer2_period_us;
 	flag_timer2 = 0;
+	__set_PRIMASK(primask);
+	timer_reprogram();
 }
 
-void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim){
-	if(htim->Instance == TIM2){
-		if(timer2_counter > 0){
-			timer2_counter--;
-			if(timer2_counter == 0) {
-				flag_timer2 = 1;
-				timer2_counter = timer2_MUL;
+uint64_t timer_now_us(void){
+	uint32_t primask = __get_PRIMASK();
+	uint32_t hi, cnt;
+	__disable_irq();
+	hi  = timer2_wraps;
+	cnt = TIM2->CNT;
+	/* Vừa tràn nhưng ngắt chưa chạy: CNT đã về gần 0 */
+	if(__HAL_TIM_GET_FLAG(&htim2, TIM_FLAG_UPDATE) && cnt < 0x80000000u) hi++;
+	__set_PRIMASK(primask);
+	return ((uint64_t)hi << 32) | cnt;
+}
+
+void timer_oneshot_at(uint64_t at_us){
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	__HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_2, (uint32_t)at_us);
+	__HAL_TIM_CLEAR_FLAG(&htim2, TIM_FLAG_CC2);
+	oneshot_armed = 1;
+	__HAL_TIM_ENABLE_IT(&htim2, TIM_IT_CC2);
+	/* Mốc đã qua (hoặc sát CNT) thì báo ngay, không chờ vòng tràn */
+	if((int32_t)((uint32_t)at_us - TIM2->CNT) <= 0){
+		__HAL_TIM_DISABLE_IT(&htim2, TIM_IT_CC2);
+		oneshot_armed = 0;
+		flag_oneshot = 1;
+	}
+	__set_PRIMASK(primask);
+}
+
+void timer_oneshot_cancel(void){
+	__HAL_TIM_DISABLE_IT(&htim2, TIM_IT_CC2);
+	oneshot_armed = 0;
+}
+
+uint8_t timer_oneshot_pending(void){
+	return oneshot_armed;
+}
+
+/* Ngủ đến khi ISR tạo việc (flag_timer2 / flag_oneshot).
+ * Kiểm tra cờ với PRIMASK=1 rồi mới WFI: ngắt đến giữa chừng vẫn đánh thức
+ * lõi (WFI không cần ngắt được phục vụ), không lỡ cờ và không ngủ quá tick. */
+void timer_sleep_until_event(void){
+	uint32_t t0 = TIM2->CNT, now;
+	__disable_irq();
+	while(!flag_timer2 && !flag_oneshot && !flag_stimer){
+		__DSB();
+		__WFI();
+		__enable_irq();		// cho ISR đang chờ chạy
+		__ISB();
+		__disable_irq();
+	}
+	__enable_irq();
+
+	now = TIM2->CNT;
+	idle_acc_us += now - t0;
+	if(now - idle_window_start >= IDLE_WINDOW_US){
+		cpu_idle_permille = (uint16_t)((uint64_t)idle_acc_us * 1000u / (now - idle_window_start));
+		idle_acc_us = 0;
+		idle_window_start = now;
+	}
+}
+
+uint16_t timer_idle_permille(void){
+	return cpu_idle_permille;
+}
+
+/* Đổi xung vào TIM2 mà CNT vẫn đếm µs liên tục. Ghi *reg = val (đổi clock)
+ * ngay sau một mép µs rồi UG: bộ chia nạp PSC mới và bắt đầu từ 0, CNT được
+ * đặt lại giá trị mép kế. Sai số chỉ là vài chu kỳ CPU giữa mép và UG. */
+void timer_retime(uint32_t tim_hz, volatile uint32_t *reg, uint32_t val){
+	uint32_t primask = __get_PRIMASK();
+	uint32_t c, edge;
+	__disable_irq();
+	TIM2->PSC = tim_hz / 1000000u - 1u;		// bản đệm, UG mới nạp
+	TIM2->CR1 |= TIM_CR1_URS;				// UG không bật cờ tràn (không đếm nhầm vòng)
+	c = TIM2->CNT;
+	while((edge = TIM2->CNT) == c);
+	*reg = val;
+	TIM2->EGR = TIM_EGR_UG;
+	TIM2->CNT = edge;
+	__set_PRIMASK(primask);
+	timer_reprogram();		// CC1 rơi đúng lúc CNT bị đặt lại thì phát bù
+}
+
+static inline uint32_t now_ms(void){
+	return (uint32_t)(timer_now_us() / 1000u);
+}
+
+/* Nạp CC1 = hạn gần nhất. Hạn của wheel đã báo (flag_stimer) thì bỏ qua
+ * đến khi vòng chính xử lý xong và nạp lại, tránh ngắt dồn liên tục. */
+void timer_reprogram(void){
+	uint32_t primask = __get_PRIMASK();
+	uint64_t now, due;
+	__disable_irq();
+	now = timer_now_us();
+	due = now + TIMER_MAX_SLEEP_US;
+	if(timer2_period_us && timer2_next_us < due) due = timer2_next_us;
+	if(stimer_armed && !flag_stimer){
+		int32_t d = (int32_t)(stimer_wake_at - (uint32_t)(now / 1000u));
+		uint64_t w = (d <= 0) ? now : (now / 1000u + (uint32_t)d) * 1000u;
+		if(w < due) due = w;
+	}
+	__HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_1, (uint32_t)due);
+	/* Hạn đã qua trong lúc nạp: phát sự kiện CC1 bằng phần mềm */
+	if((int32_t)((uint32_t)due - TIM2->CNT) <= 0) TIM2->EGR = TIM_EGR_CC1G;
+	__set_PRIMASK(primask);
+}
+
+static void timer2_due(void){
+	uint64_t now = timer_now_us();
+	if(timer2_period_us && now >= timer2_next_us){
+		if(flag_timer2) timer2_missed++;		// vòng chính chưa kịp xử lý nhịp trước
+		flag_timer2 = 1;
+		/* Cộng theo lưới chu kỳ: trễ ngắt không làm trôi nhịp */
+		timer2_next_us += timer2_period_us;
+		while(timer2_next_us <= now){
+			timer2_next_us += timer2_period_us;
+			timer2_missed++;
+		}
+	}
+	if(stimer_armed && (int32_t)((uint32_t)(now / 1000u) - stimer_wake_at) >= 0) flag_stimer = 1;
+	timer_reprogram();
+}
+
+/* ============ Timing wheel ============ */
+static void wheel_link(stimer_t *t){
+	uint32_t delta, idx;
+	stimer_t **head;
+	uint8_t lvl;
+
+	/* Đã quá hạn (xử lý trễ): đưa vào ô hiện tại, kích ngay trong lượt này */
+	if((int32_t)(t->expires - wheel_now) < 0) t->expires = wheel_now;
+	delta = t->expires - wheel_now;
+	if(delta >= STIMER_SPAN){
+		lvl = STIMER_LEVELS - 1;
+		idx = ((wheel_now + STIMER_SPAN - 1u) >> (STIMER_BITS * lvl)) & STIMER_MASK;
+	} else {
+		for(lvl = 0; delta >= (1u << (STIMER_BITS * (lvl + 1))); lvl++);
+		idx = (t->expires >> (STIMER_BITS * lvl)) & STIMER_MASK;
+	}
+	t->lvl = lvl;
+	wheel_occ[lvl] |= 1ull << idx;
+	head = &wheel[lvl][idx];
+	t->prev = 0;
+	t->next = *head;
+	if(*head) (*head)->prev = t;
+	*head = t;
+	t->slot = head;
+}
+
+static void wheel_unlink(stimer_t *t){
+	if(t->prev) t->prev->next = t->next;
+	else *t->slot = t->next;
+	if(t->next) t->next->prev = t->prev;
+	t->next = t->prev = 0;
+	if(!*t->slot) wheel_occ[t->lvl] &= ~(1ull << (uint32_t)(t->slot - wheel[t->lvl]));
+}
+
+/* Số ô (1..64) từ ô base tới ô khác rỗng kế tiếp của tầng lvl; 0 nếu tầng
+ * rỗng. Xoay bitmap để bit 0 là ô base + 1 rồi đếm số 0 cuối */
+static uint32_t wheel_next_slot(uint8_t lvl, uint32_t base){
+	uint64_t occ = wheel_occ[lvl];
+	uint32_t s = (base + 1u) & STIMER_MASK;
+	if(!occ) return 0;
+	if(s) occ = (occ >> s) | (occ << (STIMER_SLOTS - s));
+	return (uint32_t)__builtin_ctzll(occ) + 1u;
+}
+
+/* Đổ ô idx của tầng lvl xuống các tầng thấp hơn */
+static uint32_t wheel_cascade(uint8_t lvl, uint32_t idx){
+	stimer_t *t = wheel[lvl][idx];
+	wheel[lvl][idx] = 0;
+	wheel_occ[lvl] &= ~(1ull << idx);		// trước khi xếp lại: tầng cuối có thể về đúng ô này
+	while(t){
+		stimer_t *n = t->next;
+		t->next = t->prev = 0;
+		wheel_link(t);
+		t = n;
+	}
+	return idx;
+}
+
+/* Mốc đánh thức: cận dưới của hạn sớm nhất = ô khác rỗng đầu tiên ở mỗi
+ * tầng (tầng cao lấy thời điểm đầu ô). Dậy sớm chỉ tốn một lượt rỗng;
+ * stimer_process tự đổ tầng trên đường đi nên không cần dậy ở mỗi lần đổ. */
+static void wheel_update_wake(void){
+	uint32_t best = 0x7FFFFFFFu;
+	for(uint8_t lvl = 0; lvl < STIMER_LEVELS; lvl++){
+		uint32_t shift = STIMER_BITS * lvl;
+		uint32_t base = wheel_now >> shift;
+		uint32_t k = wheel_next_slot(lvl, base);
+		if(k){
+			uint32_t d = ((base + k) << shift) - wheel_now;
+			if(d < best) best = d;
+		}
+	}
+	stimer_wake_at = wheel_now + best;
+	if((int32_t)(now_ms() - stimer_wake_at) >= 0) flag_stimer = 1;
+	timer_reprogram();
+}
+
+void stimer_init(stimer_t *t, stimer_cb_t cb, void *ctx){
+	t->next = t->prev = 0;
+	t->slot = 0;
+	t->cb = cb;
+	t->ctx = ctx;
+	t->flag = 0;
+	t->period = 0;
+	t->active = 0;
+}
+
+void stimer_init_flag(stimer_t *t, volatile uint8_t *flag){
+	stimer_init(t, 0, 0);
+	t->flag = flag;
+}
+
+void stimer_start(stimer_t *t, uint32_t delay_ms, uint32_t period_ms){
+	if(t->active) wheel_unlink(t);
+	else stimer_armed++;
+	/* Gọi từ vòng chính: wheel_now chưa theo kịp stimer_ticks thì bù phần chênh */
+	t->expires = now_ms() + (delay_ms ? delay_ms : 1u);
+	t->period = period_ms;
+	t->active = 1;
+	wheel_link(t);
+	/* Chỉ kéo mốc đánh thức sớm lại nếu cần: O(1) */
+	if((int32_t)(t->expires - stimer_wake_at) < 0 || stimer_armed == 1){
+		stimer_wake_at = t->expires;
+		timer_reprogram();
+	}
+}
+
+void stimer_stop(stimer_t *t){
+	if(!t->active) return;
+	wheel_unlink(t);
+	t->active = 0;
+	stimer_armed--;
+}
+
+uint32_t stimer_now_ms(void){
+	return now_ms();
+}
+
+void stimer_process(void){
+	uint32_t target = now_ms();
+	flag_stimer = 0;
+	if(stimer_armed == 0) wheel_now = target;		// bánh xe rỗng: nhảy thẳng
+
+	while((int32_t)(target - wheel_now) > 0){
+		stimer_t **slot;
+		/* Nhảy thẳng tới ô tầng 0 khác rỗng kế tiếp hoặc lần đổ tầng kế,
+		 * cái nào sớm hơn (hoặc target) */
+		uint32_t step = STIMER_SLOTS - (wheel_now & STIMER_MASK);
+		uint32_t k = wheel_next_slot(0, wheel_now);
+		if(k && k < step) step = k;
+		if((int32_t)(target - (wheel_now + step)) < 0){
+			wheel_now = target;
+			break;
+		}
+		wheel_now += step;
+		if((wheel_now & STIMER_MASK) == 0
+		   && wheel_cascade(1, (wheel_now >> STIMER_BITS) & STIMER_MASK) == 0
+		   && wheel_cascade(2, (wheel_now >> (2 * STIMER_BITS)) & STIMER_MASK) == 0){
+			wheel_cascade(3, (wheel_now >> (3 * STIMER_BITS)) & STIMER_MASK);
+		}
+		slot = &wheel[0][wheel_now & STIMER_MASK];
+		while(*slot){
+			stimer_t *t = *slot;
+			wheel_unlink(t);
+			if(t->period){
+				t->expires += t->period;	// giữ pha, không trôi theo độ trễ xử lý
+				wheel_link(t);
+			} else {
+				t->active = 0;
+				stimer_armed--;
 			}
+			if(t->cb) t->cb(t, t->ctx);
+			else if(t->flag) *t->flag = 1;
 		}
 	}
+	wheel_update_wake();
+}
+
+/* So khớp CC1: chỉ đến khi thật sự có hạn */
+void HAL_TIM_OC_DelayElapsedCallback(TIM_HandleTypeDef *htim){
+	if(htim->Instance == TIM2 && htim->Channel == HAL_TIM_ACTIVE_CHANNEL_1){
+		timer2_due();
+	} else if(htim->Instance == TIM2 && htim->Channel == HAL_TIM_ACTIVE_CHANNEL_2){
+		__HAL_TIM_DISABLE_IT(htim, TIM_IT_CC2);
+		oneshot_armed = 0;
+		flag_oneshot = 1;
+	}
+}
+
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim){
+	if(htim->Instance == TIM2){
+		timer2_wraps++;
+	}
 }
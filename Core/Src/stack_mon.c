@@ -0,0 +1,54 @@
+/*
+ * stack_mon.c
+ */
+#include "stack_mon.h"
+#include "dlog.h"
+
+extern uint8_t _estack;				// linker script
+extern uint32_t _Min_Stack_Size;	// giá trị là địa chỉ của symbol
+
+#define STACK_CHECK_MS	1000
+
+uint32_t stack_hwm = 0;
+static uint32_t check_last_ms;
+static uint8_t overflow_logged;
+
+static uint32_t *stack_limit(void){
+	return (uint32_t *)((uintptr_t)&_estack - (uintptr_t)&_Min_Stack_Size);
+}
+
+void stack_paint(void){
+	uint32_t *p = stack_limit();
+	uint32_t *end = (uint32_t *)(uintptr_t)((__get_MSP() - STACK_PAINT_MARGIN) & ~3u);
+	while(p < end) *p++ = STACK_PAINT;
+}
+
+uint32_t stack_size(void){
+	return (uint32_t)(uintptr_t)&_Min_Stack_Size;
+}
+
+uint32_t stack_high_water(void){
+	uint32_t *p = stack_limit();
+	uint32_t *top = (uint32_t *)&_estack;
+	while(p < top && *p == STACK_PAINT) p++;
+	return (uint32_t)((uint8_t *)top - (uint8_t *)p);
+}
+
+uint8_t stack_overflowed(void){
+	return *stack_limit() != STACK_PAINT;
+}
+
+void stack_check(void){
+	uint32_t hwm;
+	if(HAL_GetTick() - check_last_ms < STACK_CHECK_MS) return;
+	check_last_ms = HAL_GetTick();
+	hwm = stack_high_water();
+	if(hwm > stack_hwm){
+		stack_hwm = hwm;
+		DLOG("stack: sâu nhất %u / %u byte", hwm, stack_size());
+	}
+	if(!overflow_logged && stack_overflowed()){
+		overflow_logged = 1;
+		DLOG("stack: tràn vùng %u byte", stack_size());
+	}
+}
@@ -0,0 +1,94 @@
+/*
+ * stopwatch.c
+ */
+#include "stopwatch.h"
+
+typedef struct {
+	uint64_t acc_us;		// tổng các đoạn đã dừng
+	uint64_t start_us;		// mốc bắt đầu đoạn đang chạy
+	bool     running;
+} sw_span_t;
+
+static sw_span_t sw, cd;
+
+static uint64_t sw_laps[SW_LAP_MAX];		// thời gian từng vòng
+static uint16_t sw_laps_n = 0;
+static uint64_t sw_last_split = 0;
+
+static uint32_t cd_preset_s = 60;
+
+static uint64_t span_elapsed(const sw_span_t *s, uint64_t now_us){
+	return s->acc_us + (s->running ? now_us - s->start_us : 0);
+}
+
+static void span_start(sw_span_t *s, uint64_t at_us){
+	if(s->running) return;
+	s->start_us = at_us;
+	s->running = true;
+}
+
+static void span_stop(sw_span_t *s, uint64_t at_us){
+	if(!s->running) return;
+	s->acc_us += at_us - s->start_us;
+	s->running = false;
+}
+
+/* ============ Bấm giờ ============ */
+void sw_start(uint64_t at_us){ span_start(&sw, at_us); }
+void sw_stop(uint64_t at_us){ span_stop(&sw, at_us); }
+bool sw_running(void){ return sw.running; }
+uint64_t sw_elapsed_us(uint64_t now_us){ return span_elapsed(&sw, now_us); }
+
+void sw_reset(void){
+	sw.acc_us = 0;
+	sw.running = false;
+	sw_laps_n = 0;
+	sw_last_split = 0;
+}
+
+void sw_lap(uint64_t at_us){
+	uint64_t split;
+	if(!sw.running || sw_laps_n == 0xFFFF) return;
+	split = span_elapsed(&sw, at_us);
+	sw_laps[sw_laps_n % SW_LAP_MAX] = split - sw_last_split;
+	sw_last_split = split;
+	sw_laps_n++;
+}
+
+uint16_t sw_lap_count(void){ return sw_laps_n; }
+
+uint64_t sw_lap_us(uint16_t n){
+	if(n == 0 || n > sw_laps_n || sw_laps_n - n >= SW_LAP_MAX) return 0;
+	return sw_laps[(n - 1) % SW_LAP_MAX];
+}
+
+/* ============ Đếm ngược ============ */
+void cd_set_preset(uint32_t sec){
+	cd_preset_s = (sec > CD_PRESET_MAX_S) ? CD_PRESET_MAX_S : sec;
+	cd_reset();
+}
+
+uint32_t cd_preset(void){ return cd_preset_s; }
+void cd_start(uint64_t at_us){ if(cd_preset_s) span_start(&cd, at_us); }
+void cd_stop(uint64_t at_us){ span_stop(&cd, at_us); }
+bool cd_running(void){ return cd.running; }
+bool cd_at_preset(void){ return !cd.running && cd.acc_us == 0; }
+
+void cd_reset(void){
+	cd.acc_us = 0;
+	cd.running = false;
+}
+
+uint64_t cd_remaining_us(uint64_t now_us){
+	uint64_t total = (uint64_t)cd_preset_s * 1000000u;
+	uint64_t e = span_elapsed(&cd, now_us);
+	return (e >= total) ? 0 : total - e;
+}
+
+bool cd_take_expired(uint64_t now_us){
+	if(!cd.running || cd_remaining_us(now_us) > 0) return false;
+	/* Chốt đúng tại 0 thay vì tại lúc phát hiện */
+	cd.acc_us = (uint64_t)cd_preset_s * 1000000u;
+	cd.running = false;
+	return true;
+}
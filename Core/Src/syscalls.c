@@ -79,6 +79,7 @@ __attribute__((weak)) int _write(int file, char *ptr, int len)
 {
 	int DataIdx;
 
+	if (!__io_putchar) return len;   /* chưa nối kênh ra (ITM/UART): bỏ, không nhảy tới địa chỉ 0 */
 	for (DataIdx = 0; DataIdx < len; DataIdx++)
 	{
 		__io_putchar(*ptr++);
@@ -0,0 +1,55 @@
+/*
+ * trace.c
+ */
+#include "trace.h"
+
+#if TRACE_ENABLE
+
+trace_buf_t trace_buf;
+
+void trace_init(void){
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+	trace_buf.magic = TRACE_MAGIC;
+	trace_buf.n = TRACE_RING_N;
+	trace_buf.head = 0;
+	trace_buf.hz = SystemCoreClock;
+}
+
+#if TRACE_ITM
+/* Debugger chưa bật ITM hoặc cổng: bỏ qua, không chờ */
+static void trace_itm(const trace_rec_t *r){
+	const uint32_t *w = (const uint32_t *)r;
+	if(!(ITM->TCR & ITM_TCR_ITMENA_Msk) || !(ITM->TER & (1UL << TRACE_ITM_PORT))) return;
+	for(uint8_t i = 0; i < sizeof(*r) / 4; i++){
+		while(ITM->PORT[TRACE_ITM_PORT].u32 == 0);		// FIFO đầy
+		ITM->PORT[TRACE_ITM_PORT].u32 = w[i];
+	}
+}
+#endif
+
+/* Vài chục chu kỳ: khoá ngắt, 5 lần ghi. ISR cũng gọi được */
+void trace_emit(trace_id_t id, uint32_t a0, uint32_t a1){
+	uint32_t primask = __get_PRIMASK();
+	trace_rec_t *r;
+	uint32_t h;
+	__disable_irq();
+	h = trace_buf.head++;
+	r = &trace_buf.rec[h & (TRACE_RING_N - 1)];
+	r->ts = DWT->CYCCNT;
+	r->id = (uint16_t)id;
+	r->seq = (uint16_t)h;
+	r->a0 = a0;
+	r->a1 = a1;
+#if TRACE_ITM
+	trace_itm(r);
+#endif
+	__set_PRIMASK(primask);
+}
+
+void trace_clock(uint32_t old_hz){
+	trace_buf.hz = SystemCoreClock;
+	trace_emit(TRACE_CLK, SystemCoreClock, old_hz);
+}
+
+#endif /* TRACE_ENABLE */
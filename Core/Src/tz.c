@@ -0,0 +1,210 @@
+/*
+ * tz.c
+ */
+#include "tz.h"
+#include "calendar.h"
+
+#define TZ_NONE				0xFFFFFFFFu
+#define TZ_TABLE_MAX		(2 * (TZ_YEARS + 1))
+
+typedef struct {
+	uint8_t  month;			// 1..12
+	uint8_t  week;			// 1..5, 5 = tuần cuối
+	uint8_t  wday;			// 0 = CN
+	int32_t  time;			// giây sau 00:00 theo giờ đang áp dụng
+} tz_date_t;
+
+typedef struct {
+	int32_t   std_off;		// giây, dương = phía đông UTC
+	int32_t   dst_off;
+	bool      has_dst;
+	tz_date_t start, end;
+} tz_rule_t;
+
+typedef struct {
+	uint32_t utc;			// thời điểm chuyển
+	int32_t  off;			// offset sau thời điểm đó
+	bool     dst;
+} tz_trans_t;
+
+static tz_rule_t  tz_rule = { .std_off = 7 * 3600, .has_dst = false };
+static tz_trans_t tz_tab[TZ_TABLE_MAX];
+static uint8_t    tz_len = 0;
+static uint32_t   tz_tab_from = 0, tz_tab_to = 0;		// miền UTC bảng phủ
+
+/* Offset hiện tại đúng với UTC trong [tz_valid_from, tz_valid_to) */
+static uint32_t   tz_valid_from = 1, tz_valid_to = 0;
+static int32_t    tz_cur_off = 7 * 3600;
+static bool       tz_cur_dst = false;
+
+/* ============ Phân tích chuỗi ============ */
+static bool is_digit(char c){ return c >= '0' && c <= '9'; }
+static bool is_alpha(char c){ return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z'); }
+
+static const char *parse_num(const char *p, int32_t *v){
+	if(!is_digit(*p)) return 0;
+	*v = 0;
+	while(is_digit(*p)) *v = *v * 10 + (*p++ - '0');
+	return p;
+}
+
+static const char *parse_name(const char *p){
+	const char *s = p;
+	if(*p == '<'){
+		while(*p && *p != '>') p++;
+		return *p ? p + 1 : 0;
+	}
+	while(is_alpha(*p)) p++;
+	return (p - s >= 3) ? p : 0;
+}
+
+/* hh[:mm[:ss]] */
+static const char *parse_hms(const char *p, int32_t *sec){
+	int32_t h, m = 0, s = 0;
+	if(!(p = parse_num(p, &h))) return 0;
+	if(*p == ':' && !(p = parse_num(p + 1, &m))) return 0;
+	if(*p == ':' && !(p = parse_num(p + 1, &s))) return 0;
+	*sec = h * 3600 + m * 60 + s;
+	return p;
+}
+
+/* Offset POSIX tính về phía tây: "ICT-7" là UTC+7 */
+static const char *parse_off(const char *p, int32_t *off){
+	int32_t sign = 1, v;
+	if(*p == '+' || *p == '-') sign = (*p++ == '-') ? -1 : 1;
+	if(!(p = parse_hms(p, &v))) return 0;
+	*off = -sign * v;
+	return p;
+}
+
+static const char *parse_date(const char *p, tz_date_t *d){
+	int32_t m, w, wd;
+	if(*p++ != 'M') return 0;
+	if(!(p = parse_num(p, &m)) || *p++ != '.') return 0;
+	if(!(p = parse_num(p, &w)) || *p++ != '.') return 0;
+	if(!(p = parse_num(p, &wd))) return 0;
+	if(m < 1 || m > 12 || w < 1 || w > 5 || wd > 6) return 0;
+	d->month = (uint8_t)m;
+	d->week  = (uint8_t)w;
+	d->wday  = (uint8_t)wd;
+	d->time  = 2 * 3600;
+	if(*p == '/' && !(p = parse_hms(p + 1, &d->time))) return 0;
+	return p;
+}
+
+static bool parse_rule(const char *p, tz_rule_t *r){
+	if(!(p = parse_name(p)) || !(p = parse_off(p, &r->std_off))) return false;
+	r->has_dst = false;
+	if(*p == 0) return true;
+
+	if(!(p = parse_name(p))) return false;
+	r->dst_off = r->std_off + 3600;
+	if(*p != ',' && *p && !(p = parse_off(p, &r->dst_off))) return false;
+	if(*p++ != ',' || !(p = parse_date(p, &r->start))) return false;
+	if(*p++ != ',' || !(p = parse_date(p, &r->end))) return false;
+	r->has_dst = true;
+	return *p == 0;
+}
+
+/* ============ Bảng chuyển ============ */
+/* Ngày (tính từ 2000-01-01) của quy tắc Mm.w.d trong năm y */
+static uint32_t rule_day(const tz_date_t *d, uint8_t year){
+	ds3231_time_t t = { .date = 1, .month = d->month, .year = year };
+	uint32_t first = cal_to_sec(&t) / CAL_SEC_PER_DAY;
+	uint8_t  wd1   = (uint8_t)(cal_weekday_of_days(first) - 1u);
+	uint8_t  date  = (uint8_t)((d->wday + 7u - wd1) % 7u + 1u + (d->week - 1u) * 7u);
+	uint8_t  dim   = cal_days_in_month(d->month, year);
+	while(date > dim) date -= 7;
+	return first + date - 1u;
+}
+
+static void tab_insert(uint32_t utc, int32_t off, bool dst){
+	uint8_t i = tz_len++;
+	while(i > 0 && tz_tab[i - 1].utc > utc){
+		tz_tab[i] = tz_tab[i - 1];
+		i--;
+	}
+	tz_tab[i].utc = utc;
+	tz_tab[i].off = off;
+	tz_tab[i].dst = dst;
+}
+
+/* Tính các lần chuyển từ năm trước y0 đến hết y0 + TZ_YEARS - 1 */
+static void tab_build(uint8_t y0){
+	uint8_t y = y0 ? (uint8_t)(y0 - 1u) : 0;
+	uint8_t y_end = (uint8_t)(y0 + TZ_YEARS);
+	ds3231_time_t t = { .date = 1, .month = 1 };
+
+	tz_len = 0;
+	for(; y < y_end && y < 100; y++){
+		uint32_t s = rule_day(&tz_rule.start, y) * CAL_SEC_PER_DAY + (uint32_t)tz_rule.start.time;
+		uint32_t e = rule_day(&tz_rule.end,   y) * CAL_SEC_PER_DAY + (uint32_t)tz_rule.end.time;
+		tab_insert(s - (uint32_t)tz_rule.std_off, tz_rule.dst_off, true);
+		tab_insert(e - (uint32_t)tz_rule.dst_off, tz_rule.std_off, false);
+	}
+	t.year = y0;
+	tz_tab_from = cal_to_sec(&t);
+	t.year = (y_end < 100) ? y_end : 99;
+	tz_tab_to = (y_end < 100) ? cal_to_sec(&t) : TZ_NONE;
+}
+
+/* Tìm offset cho utc, tính lại bảng khi ra khỏi miền đã phủ */
+static void tz_seek(uint32_t utc){
+	uint8_t i;
+	if(!tz_rule.has_dst){
+		tz_valid_from = 0;
+		tz_valid_to   = TZ_NONE;
+		tz_cur_off    = tz_rule.std_off;
+		tz_cur_dst    = false;
+		return;
+	}
+	if(tz_len == 0 || utc < tz_tab_from || utc >= tz_tab_to){
+		ds3231_time_t t;
+		cal_from_sec(utc, &t);
+		tab_build(t.year);
+	}
+	for(i = 0; i < tz_len && tz_tab[i].utc <= utc; i++);
+	/* Bảng bắt đầu từ năm trước nên i > 0 trừ khi trước năm 2000 */
+	tz_cur_off    = i ? tz_tab[i - 1].off : tz_rule.std_off;
+	tz_cur_dst    = i ? tz_tab[i - 1].dst : false;
+	tz_valid_from = i ? tz_tab[i - 1].utc : 0;
+	tz_valid_to   = (i < tz_len) ? tz_tab[i].utc : tz_tab_to;
+}
+
+/* ============ API ============ */
+bool tz_set(const char *posix){
+	tz_rule_t r;
+	if(!posix || !parse_rule(posix, &r)) return false;
+	tz_rule = r;
+	tz_len = 0;
+	tz_valid_from = 1;
+	tz_valid_to = 0;		// miền rỗng: lần gọi sau sẽ tìm lại
+	return true;
+}
+
+uint32_t tz_to_local(uint32_t utc){
+	if(utc < tz_valid_from || utc >= tz_valid_to) tz_seek(utc);
+	return utc + (uint32_t)tz_cur_off;
+}
+
+uint32_t tz_to_utc(uint32_t local){
+	uint32_t a = local - (uint32_t)tz_rule.std_off, b, lo, hi;
+	if(!tz_rule.has_dst) return a;
+	b  = local - (uint32_t)tz_rule.dst_off;
+	lo = (a < b) ? a : b;
+	hi = (a < b) ? b : a;
+	/* Giờ lặp: cả hai ứng viên đúng, lấy cái sớm hơn (offset trước khi chuyển).
+	 * Giờ bị bỏ qua: không cái nào đúng, lấy offset đang áp dụng tại lo (trước
+	 * khi chuyển) */
+	if(tz_to_local(lo) == local) return lo;
+	if(tz_to_local(hi) == local) return hi;
+	return local - (tz_to_local(lo) - lo);
+}
+
+int32_t tz_offset(void){ return tz_cur_off; }
+
+bool tz_is_dst(void){ return tz_cur_dst; }
+
+uint32_t tz_next_change(void){
+	return tz_rule.has_dst ? tz_valid_to : TZ_NONE;
+}
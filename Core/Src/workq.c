@@ -0,0 +1,71 @@
+/*
+ * workq.c
+ */
+#include "workq.h"
+#include "dlog.h"
+
+typedef struct {
+	volatile uint32_t seq;		// = vị trí: trống; = vị trí + 1: đã ghi xong
+	work_fn_t fn;
+	uint32_t arg;
+} work_t;
+
+static work_t workq[WORKQ_LEN];
+static volatile uint32_t workq_head = 0;	// vị trí ghi kế tiếp (nhiều ISR)
+static uint32_t workq_tail = 0;				// chỉ PendSV đọc/ghi
+
+volatile uint32_t workq_dropped = 0;
+volatile uint8_t  workq_max_depth = 0;
+
+void workq_init(void){
+	for(uint32_t i = 0; i < WORKQ_LEN; i++) workq[i].seq = i;
+	workq_head = 0;
+	workq_tail = 0;
+}
+
+HAL_StatusTypeDef workq_post(work_fn_t fn, uint32_t arg){
+	uint32_t pos, depth;
+	work_t *w;
+
+	/* Giữ chỗ: tăng head nguyên tử. Bị ngắt chen giữa LDREX/STREX -> thử lại */
+	do {
+		pos = __LDREXW((uint32_t *)&workq_head);
+		w = &workq[pos & (WORKQ_LEN - 1)];
+		if(w->seq != pos){			// ô chưa được PendSV giải phóng: đầy
+			__CLREX();
+			workq_dropped++;
+			DLOG("workq: đầy, bỏ việc lần %u", workq_dropped);
+			return HAL_BUSY;
+		}
+	} while(__STREXW(pos + 1, (uint32_t *)&workq_head));
+
+	w->fn = fn;
+	w->arg = arg;
+	__DMB();
+	w->seq = pos + 1;				// công bố: PendSV được lấy ô này
+
+	depth = pos + 1 - workq_tail;
+	if(depth > workq_max_depth) workq_max_depth = (uint8_t)depth;
+	SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+	return HAL_OK;
+}
+
+void workq_run(void){
+	work_t *w;
+	work_fn_t fn;
+	uint32_t arg;
+
+	/* Ô chưa công bố: người ghi bị PendSV chen ngang (chỉ có thể là vòng chính).
+	 * Dừng ở đó; người ghi sẽ pend PendSV lại sau khi công bố */
+	for(;;){
+		w = &workq[workq_tail & (WORKQ_LEN - 1)];
+		if(w->seq != workq_tail + 1) break;
+		__DMB();
+		fn = w->fn;
+		arg = w->arg;
+		__DMB();
+		w->seq = workq_tail + WORKQ_LEN;	// trả ô cho vòng kế
+		workq_tail++;
+		fn(arg);
+	}
+}
@@ -0,0 +1,149 @@
+/*
+ * lcd_bench.c
+ *
+ *  Đo chi phí bus FSMC của các thao tác vẽ: số lần ghi lệnh/dữ liệu, số lần
+ *  đọc, và thời gian bus quy ra từ timing FSMC trong main.c ở 168 MHz.
+ *    - các hàm lcd.c gọi trực tiếp: xoá màn, fill 240x20, một ký tự 24 px
+ *      (nền đặc và trong suốt), chuỗi 10 ký tự, đường chéo 100 px, hình
+ *      tròn đặc r = 50;
+ *    - khung vẽ lại toàn phần của task ui sau mỗi lần MODE (VIEW -> SET ->
+ *      ALARM -> STOPWATCH -> COUNTDOWN -> VIEW) và khung mỗi giây ở VIEW.
+ *  Trả về 1 nếu có mục vượt ngân sách số lần ghi; sửa bảng budgets khi cố ý
+ *  đổi cách vẽ.
+ *
+ *  ./lcd_bench
+ */
+#include <stdio.h>
+#include <string.h>
+#include "sim.h"
+#include "calendar.h"
+#include "lcd.h"
+
+#define HCLK_MHZ			168					// CLK_PERF
+#define PRESS_MS			80
+#define FRAME_WINDOW_MS		300					// khung toàn phần nằm trong cửa sổ này
+#define BTN_MODE			0
+
+typedef struct {
+	const char *name;
+	uint32_t budget;		// số lần ghi (lệnh + dữ liệu) tối đa
+	sim_lcd_stats_t got;
+} bench_t;
+
+enum {
+	B_CLEAR, B_FILL, B_CHAR, B_CHAR_TR, B_STR, B_LINE, B_CIRCLE,
+	B_VIEW_SEC, B_SET, B_ALARM, B_STOPWATCH, B_COUNTDOWN, B_VIEW,
+	B_N
+};
+
+/* Số đo hiện tại + ~5 % */
+static bench_t benches[B_N] = {
+	[B_CLEAR]     = { "lcd_Clear",              80652 },
+	[B_FILL]      = { "lcd_Fill 240x20",         5052 },
+	[B_CHAR]      = { "char 24 px",               314 },
+	[B_CHAR_TR]   = { "char 24 px transparent",   881 },
+	[B_STR]       = { "str 10 chars 24 px",      3140 },
+	[B_LINE]      = { "line diag 100 px",        1273 },
+	[B_CIRCLE]    = { "circle filled r=50",    105236 },
+	[B_VIEW_SEC]  = { "frame VIEW per second",  10629 },
+	[B_SET]       = { "frame SET",              24934 },
+	[B_ALARM]     = { "frame ALARM",            25664 },
+	[B_STOPWATCH] = { "frame STOPWATCH",        52628 },
+	[B_COUNTDOWN] = { "frame COUNTDOWN",        40692 },
+	[B_VIEW]      = { "frame VIEW",             48117 },
+};
+
+static sim_lcd_stats_t stats_now(void){
+	sim_lcd_sync();
+	return sim_lcd_stats;
+}
+
+static sim_lcd_stats_t stats_sub(sim_lcd_stats_t a, sim_lcd_stats_t b){
+	return (sim_lcd_stats_t){
+		.data_writes = a.data_writes - b.data_writes,
+		.cmd_writes = a.cmd_writes - b.cmd_writes,
+		.reads = a.reads - b.reads,
+		.ram_writes = a.ram_writes - b.ram_writes,
+		.bus_ps = a.bus_ps - b.bus_ps,
+	};
+}
+
+static uint64_t writes(const sim_lcd_stats_t *s){
+	return s->data_writes + s->cmd_writes;
+}
+
+/* ============ Hàm lcd.c ============ */
+#define MEASURE(id, call) do { sim_lcd_stats_t s0 = stats_now(); call; benches[id].got = stats_sub(stats_now(), s0); } while(0)
+
+static void bench_api(void){
+	MEASURE(B_CLEAR,  lcd_Clear(BLACK));
+	MEASURE(B_FILL,   lcd_Fill(0, 0, 240, 20, BLUE));
+	MEASURE(B_CHAR,   lcd_ShowChar(100, 100, '8', WHITE, BLACK, 24, 0));
+	MEASURE(B_CHAR_TR, lcd_ShowChar(100, 140, '8', WHITE, BLACK, 24, 1));
+	MEASURE(B_STR,    lcd_ShowStr(10, 180, (uint8_t *)"0123456789", WHITE, BLACK, 24, 0));
+	MEASURE(B_LINE,   lcd_DrawLine(20, 20, 120, 120, WHITE));
+	MEASURE(B_CIRCLE, lcd_DrawCircle(120, 160, RED, 50, 1));
+}
+
+/* ============ Khung của task ui ============ */
+/* Chạy vòng lặp chính tới until_ps; trả về vòng ghi LCD nhiều nhất */
+static sim_lcd_stats_t run_max_frame(uint64_t until_ps, uint64_t release_ps){
+	sim_lcd_stats_t best = { 0 }, s0, d;
+	while(sim_ps < until_ps){
+		if(sim_ps >= release_ps){
+			sim_button_set(BTN_MODE, false);
+			release_ps = SIM_NEVER;
+		}
+		s0 = stats_now();
+		sim_main_step();
+		d = stats_sub(stats_now(), s0);
+		if(writes(&d) > writes(&best)) best = d;
+	}
+	return best;
+}
+
+/* Bấm MODE 100 ms sau một lần lật giây để khung giây không lẫn vào cửa sổ */
+static sim_lcd_stats_t press_mode(void){
+	uint64_t t;
+	run_max_frame(sim_ds3231_next_tick_ps() + 100 * SIM_PS_PER_MS, SIM_NEVER);
+	t = sim_ps;
+	sim_button_set(BTN_MODE, true);
+	return run_max_frame(t + FRAME_WINDOW_MS * SIM_PS_PER_MS, t + PRESS_MS * SIM_PS_PER_MS);
+}
+
+static void bench_frames(void){
+	/* Khởi động xong và khoá pha với chip trước khi đo */
+	run_max_frame(5 * SIM_PS_PER_S, SIM_NEVER);
+	benches[B_VIEW_SEC].got = run_max_frame(sim_ps + 3 * SIM_PS_PER_S, SIM_NEVER);
+	for(int id = B_SET; id <= B_VIEW; id++)
+		benches[id].got = press_mode();
+}
+
+/* ============ Báo cáo ============ */
+static double bus_us(const sim_lcd_stats_t *s){
+	return ((double)writes(s) * SIM_FSMC_WR_CYC + (double)s->reads * SIM_FSMC_RD_CYC) / HCLK_MHZ;
+}
+
+int main(void){
+	ds3231_time_t start = { .sec = 0, .min = 0, .hour = 3, .date = 15, .month = 6, .year = 25 };
+	int over = 0;
+
+	start.day = cal_weekday(start.date, start.month, start.year);
+	sim_board_init(cal_to_sec(&start), 0);
+	lcd_init();
+	bench_api();
+	sim_firmware_init();
+	bench_frames();
+
+	printf("%-24s %8s %8s %6s %9s %8s\n", "workload", "cmd", "data", "reads", "us@168", "budget");
+	for(int i = 0; i < B_N; i++){
+		bench_t *b = &benches[i];
+		bool bad = writes(&b->got) > b->budget;
+		printf("%-24s %8llu %8llu %6llu %9.1f %8u%s\n", b->name,
+		       (unsigned long long)b->got.cmd_writes, (unsigned long long)b->got.data_writes,
+		       (unsigned long long)b->got.reads, bus_us(&b->got), b->budget, bad ? "  OVER" : "");
+		over += bad;
+	}
+	if(over) printf("%d mục vượt ngân sách\n", over);
+	return over ? 1 : 0;
+}
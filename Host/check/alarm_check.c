@@ -0,0 +1,201 @@
+/*
+ * alarm_check.c
+ *
+ *  Kiểm tra alarm_sched.c so với mô hình dò từng phút:
+ *    - nhiều quy tắc trộn loại (hằng ngày, WEEKLY theo mặt nạ thứ,
+ *      EVERY_N_MIN, ONESHOT, một cái tắt, hai cái trùng giờ), bước từng
+ *      phút qua chín ngày: id và số lần alarm_take_due trả về mỗi phút,
+ *      alarm_next_deadline sau mỗi bước;
+ *    - sửa/xoá giữa chừng;
+ *    - giờ nhảy tới không tính lại: mỗi báo thức lỡ kích đúng một lần;
+ *    - giờ đặt lùi qua hạn ONESHOT + alarm_reschedule_all: ONESHOT đã kích
+ *      vẫn tắt, phần còn lại kích lại theo giờ mới;
+ *    - đầy ALARM_MAX thì alarm_add trả -1.
+ *  Trả về 0 nếu mọi kiểm tra đạt.
+ *
+ *  ./alarm_check
+ */
+#include <stdio.h>
+#include "calendar.h"
+#include "alarm_sched.h"
+
+#define MIN					60u
+#define HOUR				3600u
+#define DAY					CAL_SEC_PER_DAY
+#define REF_HORIZON			(8u * DAY)			// WEEKLY xa nhất 7 ngày
+
+typedef struct {
+	alarm_rule_t rule;
+	bool enabled;
+	bool used;
+} ref_t;
+
+static ref_t ref[ALARM_MAX];
+static unsigned checks_ok = 0, checks_fail = 0, fires = 0;
+
+static void stamp(uint32_t s, char *out, size_t n){
+	ds3231_time_t t;
+	if(s == ALARM_NONE){
+		snprintf(out, n, "không có");
+		return;
+	}
+	cal_from_sec(s, &t);
+	snprintf(out, n, "20%02u-%02u-%02u %02u:%02u:%02u", t.year, t.month, t.date, t.hour, t.min, t.sec);
+}
+
+static void fail(const char *what, uint32_t at, const char *detail){
+	char a[24];
+	if(++checks_fail <= 20){
+		stamp(at, a, sizeof(a));
+		printf("FAIL %-10s tại %s  %s\n", what, a, detail);
+	}
+}
+
+/* ============ Mô hình ============ */
+/* Quy tắc có lần kích đúng tại t (mọi mốc trong bài đều tròn phút) */
+static bool ref_hits(const alarm_rule_t *r, uint32_t t){
+	uint32_t day = t / DAY, sod = t % DAY;
+	switch(r->kind){
+	case ALARM_ONESHOT:
+		return t == r->at;
+	case ALARM_DAILY:
+		return sod == r->at;
+	case ALARM_WEEKLY:
+		return sod == r->at && (r->days & (1u << (cal_weekday_of_days(day) - 1u)));
+	case ALARM_EVERY_N_MIN:
+		return r->period_min && t >= r->at && (t - r->at) % (r->period_min * MIN) == 0;
+	default:
+		return false;
+	}
+}
+
+static uint32_t ref_next(int id, uint32_t now){
+	const ref_t *a = &ref[id];
+	if(!a->used || !a->enabled) return ALARM_NONE;
+	for(uint32_t t = (now / MIN + 1u) * MIN; t <= now + REF_HORIZON; t += MIN)
+		if(ref_hits(&a->rule, t)) return t;
+	return ALARM_NONE;
+}
+
+static int add(alarm_rule_t r, bool enabled, uint32_t now){
+	int id = alarm_add(&r, enabled, now);
+	if(id >= 0) ref[id] = (ref_t){ r, enabled, true };
+	return id;
+}
+
+static void update(int id, alarm_rule_t r, bool enabled, uint32_t now){
+	alarm_update(id, &r, enabled, now);
+	ref[id].rule = r;
+	ref[id].enabled = enabled;
+}
+
+static void check_deadline(uint32_t now){
+	uint32_t want = ALARM_NONE, got = alarm_next_deadline(), n;
+	char w[24], g[24], d[64];
+	for(int i = 0; i < ALARM_MAX; i++) if((n = ref_next(i, now)) < want) want = n;
+	if(want == got){
+		checks_ok++;
+		return;
+	}
+	stamp(want, w, sizeof(w));
+	stamp(got, g, sizeof(g));
+	snprintf(d, sizeof(d), "muốn %s  thấy %s", w, g);
+	fail("deadline", now, d);
+}
+
+/* Lấy hết báo thức đến hạn lúc now; muốn đúng tập `due` (bit theo id), mỗi id một lần */
+static void take_expect(uint32_t now, uint32_t due){
+	uint32_t got = 0;
+	int id;
+	char d[64];
+	while((id = alarm_take_due(now)) >= 0){
+		if(got & (1u << id)){
+			snprintf(d, sizeof(d), "id %d trả về hai lần", id);
+			fail("take_due", now, d);
+			break;
+		}
+		got |= 1u << id;
+		fires++;
+		if(ref[id].rule.kind == ALARM_ONESHOT) ref[id].enabled = false;
+	}
+	if(got == due){
+		checks_ok++;
+	} else {
+		snprintf(d, sizeof(d), "muốn id 0x%08x  thấy 0x%08x", due, got);
+		fail("take_due", now, d);
+	}
+	check_deadline(now);
+}
+
+/* Bước từng phút trong (from, to] */
+static uint32_t run(uint32_t from, uint32_t to){
+	for(uint32_t t = from + MIN; t <= to; t += MIN){
+		uint32_t due = 0;
+		for(int i = 0; i < ALARM_MAX; i++)
+			if(ref[i].used && ref[i].enabled && ref_hits(&ref[i].rule, t)) due |= 1u << i;
+		take_expect(t, due);
+	}
+	return to;
+}
+
+/* Giờ nhảy tới mà không tính lại: báo thức có lần kích trong (from, to] kích một lần */
+static uint32_t jump(uint32_t from, uint32_t to){
+	uint32_t due = 0;
+	for(int i = 0; i < ALARM_MAX; i++)
+		if(ref_next(i, from) <= to) due |= 1u << i;
+	take_expect(to, due);
+	return to;
+}
+
+int main(void){
+	/* 2026-01-02 06:00, thứ Sáu */
+	ds3231_time_t t0 = { .hour = 6, .date = 2, .month = 1, .year = 26 };
+	uint32_t now = cal_to_sec(&t0);
+	int every, once, off, twin, n;
+
+	alarm_init();
+	add((alarm_rule_t){ .at = 7 * HOUR, .kind = ALARM_DAILY }, true, now);
+	add((alarm_rule_t){ .at = 7 * HOUR + 30 * MIN, .kind = ALARM_WEEKLY, .days = ALARM_WORKDAYS }, true, now);
+	add((alarm_rule_t){ .at = 9 * HOUR, .kind = ALARM_WEEKLY, .days = ALARM_SAT | ALARM_SUN }, true, now);
+	every   = add((alarm_rule_t){ .at = now + 10 * MIN, .period_min = 45, .kind = ALARM_EVERY_N_MIN }, true, now);
+	once    = add((alarm_rule_t){ .at = now + DAY + 6 * HOUR, .kind = ALARM_ONESHOT }, true, now);
+	off     = add((alarm_rule_t){ .at = 8 * HOUR, .kind = ALARM_DAILY }, false, now);
+	twin    = add((alarm_rule_t){ .at = 7 * HOUR, .kind = ALARM_DAILY }, true, now);
+	check_deadline(now);
+
+	/* Thứ Sáu -> Chủ nhật: ngày làm việc, cuối tuần, ONESHOT thứ Bảy 12:00 */
+	now = run(now, now + 2 * DAY);
+	/* Xoá một cái trùng giờ, bật cái đang tắt, đổi chu kỳ */
+	alarm_remove(twin);
+	ref[twin].used = false;
+	update(off, ref[off].rule, true, now);
+	update(every, (alarm_rule_t){ .at = now + 5 * MIN, .period_min = 90, .kind = ALARM_EVERY_N_MIN }, true, now);
+	check_deadline(now);
+	/* Chủ nhật -> thứ Hai tuần sau: qua ranh giới tuần */
+	now = run(now, now + 7 * DAY);
+
+	/* Giờ nhảy tới 3 ngày 5 giờ (bỏ qua nhiều lần kích) */
+	now = jump(now, now + 3 * DAY + 5 * HOUR);
+	now = run(now, now + DAY);
+
+	/* Đặt lùi về trước hạn ONESHOT (thứ Bảy đầu): nó đã kích nên không sống lại */
+	if(ref[once].enabled) fail("oneshot", now, "chưa kích");
+	now = cal_to_sec(&t0) + 5 * HOUR;
+	alarm_reschedule_all(now);
+	check_deadline(now);
+	now = run(now, now + 2 * DAY);
+
+	/* Đầy */
+	for(n = 0; add((alarm_rule_t){ .at = 12 * HOUR, .kind = ALARM_DAILY }, true, now) >= 0; n++);
+	if(n != ALARM_MAX - 6){
+		char d[48];
+		snprintf(d, sizeof(d), "thêm được %d, muốn %d", n, ALARM_MAX - 6);
+		fail("full", now, d);
+	} else {
+		checks_ok++;
+	}
+	now = run(now, now + DAY);
+
+	printf("alarm checks %u đạt, %u lỗi, %u lần kích\n", checks_ok, checks_fail, fires);
+	return (checks_fail || !checks_ok) ? 1 : 0;
+}
@@ -0,0 +1,167 @@
+/*
+ * tz_check.c
+ *
+ *  Kiểm tra tz.c với hai quy tắc có DST so với các lần chuyển của tzdata
+ *  (Europe/Berlin, Australia/Sydney 2025..2028, tính sẵn):
+ *    - quét tz_to_local/tz_is_dst mỗi 15 phút qua bốn năm, đi tới rồi nhảy
+ *      lùi: đi qua cả hai lần chuyển, giao thừa và lần dựng lại bảng;
+ *    - tz_to_utc khứ hồi ở giờ thường, giờ bị bỏ qua (xuân) và giờ lặp (thu)
+ *      lấy theo offset trước khi chuyển;
+ *    - chuỗi TZ sai bị từ chối và giữ quy tắc cũ.
+ *  Trả về 0 nếu mọi kiểm tra đạt.
+ *
+ *  ./tz_check
+ */
+#include <stdio.h>
+#include "calendar.h"
+#include "tz.h"
+
+#define H					3600u
+#define SWEEP_STEP			(15u * 60u)
+
+typedef struct {
+	uint32_t utc;			// giây từ 2000-01-01
+	int32_t  off;			// offset sau thời điểm đó
+} ref_trans_t;
+
+typedef struct {
+	const char *posix;
+	int32_t std_off;
+	const ref_trans_t *tr;
+	int n;
+} zone_t;
+
+/* Từ zoneinfo của Python */
+static const ref_trans_t berlin[] = {
+	{ 796611600u, 2 * H }, { 814755600u, 1 * H },		// 2025-03-30, 2025-10-26 01:00 UTC
+	{ 828061200u, 2 * H }, { 846205200u, 1 * H },		// 2026-03-29, 2026-10-25
+	{ 859510800u, 2 * H }, { 878259600u, 1 * H },		// 2027-03-28, 2027-10-31
+	{ 890960400u, 2 * H }, { 909709200u, 1 * H },		// 2028-03-26, 2028-10-29
+};
+static const ref_trans_t sydney[] = {
+	{ 797184000u, 10 * H }, { 812908800u, 11 * H },	// 2025-04-05, 2025-10-04 16:00 UTC
+	{ 828633600u, 10 * H }, { 844358400u, 11 * H },	// 2026-04-04, 2026-10-03
+	{ 860083200u, 10 * H }, { 875808000u, 11 * H },	// 2027-04-03, 2027-10-02
+	{ 891532800u, 10 * H }, { 907257600u, 11 * H },	// 2028-04-01, 2028-09-30
+};
+
+static const zone_t zones[] = {
+	{ "CET-1CEST,M3.5.0,M10.5.0/3",   1 * H, berlin, 8 },
+	{ "AEST-10AEDT,M10.1.0,M4.1.0/3", 10 * H, sydney, 8 },
+};
+
+static unsigned checks_ok = 0, checks_fail = 0;
+
+static void stamp(uint32_t s, char *out, size_t n){
+	ds3231_time_t t;
+	cal_from_sec(s, &t);
+	snprintf(out, n, "20%02u-%02u-%02u %02u:%02u:%02u", t.year, t.month, t.date, t.hour, t.min, t.sec);
+}
+
+static void expect(const char *what, uint32_t at, uint32_t want, uint32_t got){
+	char a[24], w[24], g[24];
+	if(want == got){
+		checks_ok++;
+		return;
+	}
+	if(++checks_fail <= 20){
+		stamp(at, a, sizeof(a));
+		stamp(want, w, sizeof(w));
+		stamp(got, g, sizeof(g));
+		printf("FAIL %-12s tại %s  muốn %s  thấy %s\n", what, a, w, g);
+	}
+}
+
+static void fail_flag(const char *what, uint32_t at){
+	char a[24];
+	if(++checks_fail <= 20){
+		stamp(at, a, sizeof(a));
+		printf("FAIL %-12s tại %s\n", what, a);
+	}
+}
+
+/* Offset theo bảng tham chiếu; trước lần chuyển đầu (2025) là giờ ngược với nó */
+static int32_t ref_off(const zone_t *z, uint32_t utc){
+	int32_t off = (z->tr[0].off == z->std_off) ? z->std_off + (int32_t)H : z->std_off;
+	for(int i = 0; i < z->n && z->tr[i].utc <= utc; i++) off = z->tr[i].off;
+	return off;
+}
+
+static void sweep(const zone_t *z, uint32_t from, uint32_t to, int32_t step){
+	for(uint32_t u = from; step > 0 ? u < to : u > to; u += (uint32_t)step){
+		int32_t off = ref_off(z, u);
+		expect("to_local", u, u + (uint32_t)off, tz_to_local(u));
+		if(tz_is_dst() != (off != z->std_off)) fail_flag("is_dst", u);
+		else checks_ok++;
+	}
+}
+
+static void check_zone(const zone_t *z){
+	ds3231_time_t y2025 = { .date = 1, .month = 1, .year = 25 };
+	ds3231_time_t y2029 = { .date = 1, .month = 1, .year = 29 };
+	uint32_t from = cal_to_sec(&y2025), to = cal_to_sec(&y2029);
+
+	if(!tz_set(z->posix)){
+		printf("FAIL tz_set   \"%s\" bị từ chối\n", z->posix);
+		checks_fail++;
+		return;
+	}
+	sweep(z, from, to, SWEEP_STEP);
+	/* Nhảy lùi (đặt lại giờ về trước): bảng phải dựng lại cho năm cũ */
+	sweep(z, to - H, from, -(int32_t)(7u * H + SWEEP_STEP));
+
+	for(int i = 0; i < z->n; i++){
+		const ref_trans_t *tr = &z->tr[i];
+		int32_t before = ref_off(z, tr->utc - 1u);
+		int32_t after = tr->off;
+		int32_t jump = after - before;
+		uint32_t at_local = tr->utc + (uint32_t)before;		// giờ đồng hồ lúc chuyển
+
+		/* Ngay trước/sau lần chuyển và lần chuyển kế tiếp nhìn từ trước đó */
+		expect("to_local-1", tr->utc - 1u, tr->utc - 1u + (uint32_t)before, tz_to_local(tr->utc - 1u));
+		expect("next_change", tr->utc - 1u, tr->utc, tz_next_change());
+		expect("to_local", tr->utc, tr->utc + (uint32_t)after, tz_to_local(tr->utc));
+
+		/* Khứ hồi một giờ trước và sau vùng chuyển */
+		expect("to_utc", tr->utc - 2u * H, tr->utc - 2u * H, tz_to_utc(at_local - 2u * H));
+		expect("to_utc", tr->utc + 2u * H, tr->utc + 2u * H, tz_to_utc(at_local + (uint32_t)jump + 2u * H));
+
+		/* Giữa vùng: xuân (jump > 0) là giờ không tồn tại, thu là giờ lặp;
+		 * cả hai lấy offset trước khi chuyển */
+		if(jump > 0){
+			expect("to_utc gap", tr->utc, tr->utc + 30u * 60u, tz_to_utc(at_local + 30u * 60u));
+		} else {
+			expect("to_utc dup", tr->utc, tr->utc - 30u * 60u, tz_to_utc(at_local - 30u * 60u));
+		}
+	}
+}
+
+int main(void){
+	ds3231_time_t t = { .hour = 12, .date = 1, .month = 7, .year = 26 };
+	uint32_t mid = cal_to_sec(&t);
+	static const char *bad[] = {
+		"", "C-1", "CET", "CET-1CEST", "CET-1CEST,M3.5.0", "CET-1CEST,M13.5.0,M10.5.0",
+		"CET-1CEST,M3.6.0,M10.5.0", "CET-1CEST,M3.5.7,M10.5.0", "CET-1CEST,J60,M10.5.0",
+		"CET-1CEST,M3.5.0,M10.5.0/", "CET-1CEST,M3.5.0,M10.5.0x",
+	};
+
+	for(unsigned i = 0; i < sizeof(zones) / sizeof(zones[0]); i++) check_zone(&zones[i]);
+
+	/* Chuỗi sai: giữ nguyên quy tắc đang dùng (Sydney) */
+	for(unsigned i = 0; i < sizeof(bad) / sizeof(bad[0]); i++){
+		if(tz_set(bad[i])){
+			printf("FAIL tz_set   nhận chuỗi sai \"%s\"\n", bad[i]);
+			checks_fail++;
+		}
+	}
+	expect("kept rule", mid, mid + 10u * H, tz_to_local(mid));
+
+	/* Không DST: offset cố định, không có lần chuyển */
+	tz_set(TZ_DEFAULT);
+	expect("ICT-7", mid, mid + 7u * H, tz_to_local(mid));
+	expect("ICT-7 utc", mid, mid, tz_to_utc(mid + 7u * H));
+	expect("ICT-7 next", mid, 0xFFFFFFFFu, tz_next_change());
+
+	printf("tz checks    %u đạt, %u lỗi\n", checks_ok, checks_fail);
+	return (checks_fail || !checks_ok) ? 1 : 0;
+}
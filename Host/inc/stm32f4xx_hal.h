@@ -0,0 +1,364 @@
+/*
+ * stm32f4xx_hal.h (host)
+ *
+ *  Thay HAL/CMSIS của ST khi build trên máy tính: Core/Inc/main.h include
+ *  file này (Host/Makefile đặt -IHost/inc), mọi thứ khác trong Core giữ
+ *  nguyên. Chỉ có những kiểu, hằng và hàm mà Core/Src dùng; giá trị hằng giống bản ST để các phép ghép thanh
+ *  ghi (clock_gov, software_timer) chạy y như trên chip.
+ *
+ *  Thanh ghi ngoại vi (TIM2, RCC, SCB, DWT...) là struct trong RAM; mỗi lần
+ *  lấy con trỏ là một lần truy cập bus: thời gian mô phỏng trôi, ghi lần
+ *  trước được áp dụng, ngắt đến hạn được giao (Host/sim/sim_core.c).
+ */
+
+#ifndef HOST_STM32F4XX_HAL_H_
+#define HOST_STM32F4XX_HAL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define __IO volatile
+#define UNUSED(x) ((void)(x))
+
+typedef enum {
+	HAL_OK      = 0x00U,
+	HAL_ERROR   = 0x01U,
+	HAL_BUSY    = 0x02U,
+	HAL_TIMEOUT = 0x03U
+} HAL_StatusTypeDef;
+
+/* ============ NVIC ============ */
+typedef enum {
+	PendSV_IRQn        = -2,
+	EXTI0_IRQn         = 6,
+	DMA1_Stream0_IRQn  = 11,
+	DMA1_Stream6_IRQn  = 17,
+	TIM2_IRQn          = 28,
+	I2C1_EV_IRQn       = 31,
+	I2C1_ER_IRQn       = 32,
+	SPI1_IRQn          = 35,
+} IRQn_Type;
+
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority);
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn);
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn);
+
+/* ============ Lõi ============ */
+void     sim_disable_irq(void);
+void     sim_enable_irq(void);
+uint32_t sim_get_primask(void);
+void     sim_set_primask(uint32_t m);
+void     sim_wfi(void);
+
+static inline void     __disable_irq(void)          { sim_disable_irq(); }
+static inline void     __enable_irq(void)           { sim_enable_irq(); }
+static inline uint32_t __get_PRIMASK(void)          { return sim_get_primask(); }
+static inline void     __set_PRIMASK(uint32_t m)    { sim_set_primask(m); }
+static inline void     __WFI(void)                  { sim_wfi(); }
+static inline void     __DMB(void)                  { __sync_synchronize(); }
+static inline void     __DSB(void)                  { __sync_synchronize(); }
+static inline void     __ISB(void)                  { __sync_synchronize(); }
+/* Một luồng: STREX luôn thành công (ngắt chỉ chen ở điểm truy cập ngoại vi) */
+static inline uint32_t __LDREXW(volatile uint32_t *p)             { return *p; }
+static inline uint32_t __STREXW(uint32_t v, volatile uint32_t *p) { *p = v; return 0; }
+static inline void     __CLREX(void)                { }
+
+typedef struct { __IO uint32_t ICSR; } SCB_Type;
+#define SCB_ICSR_PENDSVSET_Msk		(1UL << 28)
+SCB_Type *sim_scb(void);
+#define SCB							(sim_scb())
+
+typedef struct { __IO uint32_t DEMCR; } CoreDebug_Type;
+#define CoreDebug_DEMCR_TRCENA_Msk	(1UL << 24)
+CoreDebug_Type *sim_coredebug(void);
+#define CoreDebug					(sim_coredebug())
+
+typedef struct { __IO uint32_t CTRL; __IO uint32_t CYCCNT; } DWT_Type;
+#define DWT_CTRL_CYCCNTENA_Msk		(1UL << 0)
+DWT_Type *sim_dwt(void);
+#define DWT							(sim_dwt())
+
+typedef struct { __IO uint32_t CR; } DBGMCU_TypeDef;
+#define DBGMCU_CR_DBG_SLEEP			(1UL << 0)
+DBGMCU_TypeDef *sim_dbgmcu(void);
+#define DBGMCU						(sim_dbgmcu())
+
+/* ============ RCC / FLASH ============ */
+typedef struct {
+	__IO uint32_t CR;
+	__IO uint32_t PLLCFGR;
+	__IO uint32_t CFGR;
+} RCC_TypeDef;
+RCC_TypeDef *sim_rcc(void);
+#define RCC							(sim_rcc())
+
+#define RCC_CR_PLLON				(1UL << 24)
+#define RCC_CR_PLLRDY				(1UL << 25)
+#define RCC_CFGR_SW					(0x3UL << 0)
+#define RCC_CFGR_SW_HSI				0x00000000U
+#define RCC_CFGR_SW_HSE				0x00000001U
+#define RCC_CFGR_SW_PLL				0x00000002U
+#define RCC_CFGR_SWS_Pos			2U
+#define RCC_CFGR_SWS				(0x3UL << RCC_CFGR_SWS_Pos)
+#define RCC_CFGR_HPRE				(0xFUL << 4)
+#define RCC_CFGR_HPRE_DIV1			0x00000000U
+#define RCC_CFGR_HPRE_DIV2			0x00000080U
+#define RCC_CFGR_PPRE1				(0x7UL << 10)
+#define RCC_CFGR_PPRE1_DIV1			0x00000000U
+#define RCC_CFGR_PPRE1_DIV2			0x00001000U
+#define RCC_CFGR_PPRE1_DIV4			0x00001400U
+#define RCC_CFGR_PPRE2				(0x7UL << 13)
+#define RCC_CFGR_PPRE2_DIV1			0x00000000U
+#define RCC_CFGR_PPRE2_DIV2			0x00008000U
+#define RCC_CFGR_PPRE2_DIV4			0x0000A000U
+
+#define __HAL_RCC_GPIOA_CLK_ENABLE()	((void)0)
+#define __HAL_RCC_GPIOB_CLK_ENABLE()	((void)0)
+#define __HAL_RCC_GPIOC_CLK_ENABLE()	((void)0)
+#define __HAL_RCC_GPIOD_CLK_ENABLE()	((void)0)
+#define __HAL_RCC_GPIOE_CLK_ENABLE()	((void)0)
+#define __HAL_RCC_GPIOG_CLK_ENABLE()	((void)0)
+
+extern uint32_t SystemCoreClock;
+void     SystemCoreClockUpdate(void);
+uint32_t HAL_RCC_GetHCLKFreq(void);
+uint32_t HAL_RCC_GetPCLK1Freq(void);
+uint32_t HAL_RCC_GetPCLK2Freq(void);
+
+#define FLASH_LATENCY_0				0U
+#define FLASH_LATENCY_2				2U
+#define FLASH_LATENCY_5				5U
+#define __HAL_FLASH_SET_LATENCY(l)	((void)(l))
+
+/* ============ Tick ============ */
+extern __IO uint32_t uwTick;
+uint32_t HAL_GetTick(void);
+void     HAL_IncTick(void);
+void     HAL_Delay(uint32_t Delay);
+void     HAL_SuspendTick(void);
+void     HAL_ResumeTick(void);
+
+/* ============ GPIO / EXTI ============ */
+typedef struct { uint32_t port; __IO uint32_t ODR; __IO uint32_t IDR; } GPIO_TypeDef;
+extern GPIO_TypeDef sim_gpio[7];
+#define GPIOA						(&sim_gpio[0])
+#define GPIOB						(&sim_gpio[1])
+#define GPIOC						(&sim_gpio[2])
+#define GPIOD						(&sim_gpio[3])
+#define GPIOE						(&sim_gpio[4])
+#define GPIOF						(&sim_gpio[5])
+#define GPIOG						(&sim_gpio[6])
+
+typedef enum { GPIO_PIN_RESET = 0, GPIO_PIN_SET } GPIO_PinState;
+
+#define GPIO_PIN_0					((uint16_t)0x0001)
+#define GPIO_PIN_1					((uint16_t)0x0002)
+#define GPIO_PIN_2					((uint16_t)0x0004)
+#define GPIO_PIN_3					((uint16_t)0x0008)
+#define GPIO_PIN_4					((uint16_t)0x0010)
+#define GPIO_PIN_5					((uint16_t)0x0020)
+#define GPIO_PIN_6					((uint16_t)0x0040)
+#define GPIO_PIN_7					((uint16_t)0x0080)
+#define GPIO_PIN_8					((uint16_t)0x0100)
+#define GPIO_PIN_9					((uint16_t)0x0200)
+#define GPIO_PIN_10					((uint16_t)0x0400)
+#define GPIO_PIN_11					((uint16_t)0x0800)
+#define GPIO_PIN_12					((uint16_t)0x1000)
+#define GPIO_PIN_13					((uint16_t)0x2000)
+#define GPIO_PIN_14					((uint16_t)0x4000)
+#define GPIO_PIN_15					((uint16_t)0x8000)
+
+typedef struct {
+	uint32_t Pin;
+	uint32_t Mode;
+	uint32_t Pull;
+	uint32_t Speed;
+	uint32_t Alternate;
+} GPIO_InitTypeDef;
+
+#define GPIO_MODE_INPUT				0x00000000U
+#define GPIO_MODE_OUTPUT_PP			0x00000001U
+#define GPIO_MODE_IT_FALLING		0x10210000U
+#define GPIO_NOPULL					0x00000000U
+#define GPIO_PULLUP					0x00000001U
+
+void          HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init);
+void          HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+void          HAL_GPIO_EXTI_IRQHandler(uint16_t GPIO_Pin);
+void          HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin);
+
+/* ============ FSMC ============ */
+typedef struct { uint32_t id; } SRAM_HandleTypeDef;	// LCD đi qua sim_lcd_port()
+
+/* ============ DMA ============ */
+typedef struct { uint32_t stream; } DMA_HandleTypeDef;
+void HAL_DMA_IRQHandler(DMA_HandleTypeDef *hdma);
+
+/* ============ I2C ============ */
+typedef struct { uint32_t id; } I2C_TypeDef;
+extern I2C_TypeDef sim_i2c1;
+#define I2C1						(&sim_i2c1)
+
+typedef enum {
+	HAL_I2C_STATE_RESET   = 0x00U,
+	HAL_I2C_STATE_READY   = 0x20U,
+	HAL_I2C_STATE_BUSY_TX = 0x21U,
+	HAL_I2C_STATE_BUSY_RX = 0x22U,
+} HAL_I2C_StateTypeDef;
+
+typedef struct {
+	uint32_t ClockSpeed;
+	uint32_t DutyCycle;
+	uint32_t OwnAddress1;
+	uint32_t AddressingMode;
+	uint32_t DualAddressMode;
+	uint32_t OwnAddress2;
+	uint32_t GeneralCallMode;
+	uint32_t NoStretchMode;
+} I2C_InitTypeDef;
+
+typedef struct {
+	I2C_TypeDef *Instance;
+	I2C_InitTypeDef Init;
+	DMA_HandleTypeDef *hdmatx;
+	DMA_HandleTypeDef *hdmarx;
+	__IO HAL_I2C_StateTypeDef State;
+} I2C_HandleTypeDef;
+
+#define I2C_MEMADD_SIZE_8BIT		0x00000001U
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c);
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef *hi2c);
+HAL_StatusTypeDef HAL_I2C_IsDeviceReady(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint32_t Trials, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                    uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                   uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Write_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                       uint16_t MemAddSize, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_I2C_Mem_Read_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                      uint16_t MemAddSize, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_I2C_Mem_Write_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                        uint16_t MemAddSize, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_I2C_Mem_Read_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                       uint16_t MemAddSize, uint8_t *pData, uint16_t Size);
+void HAL_I2C_EV_IRQHandler(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_ER_IRQHandler(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c);
+
+/* ============ SPI ============ */
+typedef struct { uint32_t id; } SPI_TypeDef;
+extern SPI_TypeDef sim_spi1;
+#define SPI1						(&sim_spi1)
+
+typedef enum {
+	HAL_SPI_STATE_RESET   = 0x00U,
+	HAL_SPI_STATE_READY   = 0x01U,
+	HAL_SPI_STATE_BUSY    = 0x02U,
+	HAL_SPI_STATE_BUSY_RX = 0x04U,
+} HAL_SPI_StateTypeDef;
+
+typedef struct {
+	uint32_t Mode;
+	uint32_t Direction;
+	uint32_t DataSize;
+	uint32_t CLKPolarity;
+	uint32_t CLKPhase;
+	uint32_t NSS;
+	uint32_t BaudRatePrescaler;
+	uint32_t FirstBit;
+	uint32_t TIMode;
+	uint32_t CRCCalculation;
+	uint32_t CRCPolynomial;
+} SPI_InitTypeDef;
+
+typedef struct {
+	SPI_TypeDef *Instance;
+	SPI_InitTypeDef Init;
+	uint8_t *pRxBuffPtr;
+	uint16_t RxXferSize;
+	__IO HAL_SPI_StateTypeDef State;
+} SPI_HandleTypeDef;
+
+#define SPI_BAUDRATEPRESCALER_2		0x00000000U
+#define SPI_BAUDRATEPRESCALER_4		0x00000008U
+#define SPI_BAUDRATEPRESCALER_8		0x00000010U
+#define SPI_BAUDRATEPRESCALER_16	0x00000018U
+#define SPI_BAUDRATEPRESCALER_32	0x00000020U
+#define SPI_BAUDRATEPRESCALER_64	0x00000028U
+#define SPI_BAUDRATEPRESCALER_128	0x00000030U
+#define SPI_BAUDRATEPRESCALER_256	0x00000038U
+
+HAL_StatusTypeDef    HAL_SPI_Init(SPI_HandleTypeDef *hspi);
+HAL_StatusTypeDef    HAL_SPI_Receive_IT(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size);
+HAL_SPI_StateTypeDef HAL_SPI_GetState(SPI_HandleTypeDef *hspi);
+void HAL_SPI_IRQHandler(SPI_HandleTypeDef *hspi);
+void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *hspi);
+
+/* ============ TIM ============ */
+typedef struct {
+	__IO uint32_t CR1;
+	__IO uint32_t DIER;
+	__IO uint32_t SR;
+	__IO uint32_t EGR;
+	__IO uint32_t CNT;
+	__IO uint32_t PSC;
+	__IO uint32_t ARR;
+	__IO uint32_t CCR1;
+	__IO uint32_t CCR2;
+} TIM_TypeDef;
+TIM_TypeDef *sim_tim2(void);
+#define TIM2						(sim_tim2())
+
+typedef enum {
+	HAL_TIM_ACTIVE_CHANNEL_1       = 0x01U,
+	HAL_TIM_ACTIVE_CHANNEL_2       = 0x02U,
+	HAL_TIM_ACTIVE_CHANNEL_CLEARED = 0x00U,
+} HAL_TIM_ActiveChannel;
+
+typedef struct {
+	uint32_t Prescaler;
+	uint32_t Period;
+} TIM_Base_InitTypeDef;
+
+typedef struct {
+	TIM_TypeDef *Instance;
+	TIM_Base_InitTypeDef Init;
+	HAL_TIM_ActiveChannel Channel;
+} TIM_HandleTypeDef;
+
+#define TIM_CR1_URS					(1U << 2)
+#define TIM_SR_UIF					(1U << 0)
+#define TIM_SR_CC1IF				(1U << 1)
+#define TIM_SR_CC2IF				(1U << 2)
+#define TIM_EGR_UG					(1U << 0)
+#define TIM_EGR_CC1G				(1U << 1)
+#define TIM_EGR_CC2G				(1U << 2)
+#define TIM_IT_UPDATE				(1U << 0)
+#define TIM_IT_CC1					(1U << 1)
+#define TIM_IT_CC2					(1U << 2)
+#define TIM_FLAG_UPDATE				TIM_SR_UIF
+#define TIM_FLAG_CC1				TIM_SR_CC1IF
+#define TIM_FLAG_CC2				TIM_SR_CC2IF
+#define TIM_CHANNEL_1				0x00000000U
+#define TIM_CHANNEL_2				0x00000004U
+
+/* Chỉ có TIM2; đi qua TIM2 để mỗi lần truy cập cũng là một lần đồng bộ */
+#define SIM_TIM(h)					((void)(h), TIM2)
+#define __HAL_TIM_SET_COMPARE(h, ch, v) \
+	((ch) == TIM_CHANNEL_1 ? (SIM_TIM(h)->CCR1 = (v)) : (SIM_TIM(h)->CCR2 = (v)))
+#define __HAL_TIM_GET_FLAG(h, f)	((SIM_TIM(h)->SR & (f)) == (f))
+#define __HAL_TIM_CLEAR_FLAG(h, f)	(SIM_TIM(h)->SR = ~(uint32_t)(f))
+#define __HAL_TIM_ENABLE_IT(h, i)	(SIM_TIM(h)->DIER |= (i))
+#define __HAL_TIM_DISABLE_IT(h, i)	(SIM_TIM(h)->DIER &= ~(uint32_t)(i))
+
+HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_OC_Start_IT(TIM_HandleTypeDef *htim, uint32_t Channel);
+void HAL_TIM_IRQHandler(TIM_HandleTypeDef *htim);
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim);
+void HAL_TIM_OC_DelayElapsedCallback(TIM_HandleTypeDef *htim);
+
+#endif /* HOST_STM32F4XX_HAL_H_ */
@@ -0,0 +1,112 @@
+/*
+ * sim.h
+ *
+ *  Lõi mô phỏng dùng chung giữa các mô hình ngoại vi (Host/sim) và harness.
+ *  Thời gian tính bằng ps. CPU chỉ tốn thời gian ở các điểm truy cập bus
+ *  (thanh ghi, FSMC, gọi HAL); phần tính toán thuần C coi như tức thời.
+ */
+
+#ifndef HOST_SIM_SIM_H_
+#define HOST_SIM_SIM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "main.h"
+
+#define SIM_PS_PER_US		1000000ull
+#define SIM_PS_PER_MS		1000000000ull
+#define SIM_PS_PER_S		1000000000000ull
+#define SIM_NEVER			UINT64_MAX
+
+/* Chi phí (chu kỳ HCLK) của các thao tác không đi qua struct thanh ghi */
+#define SIM_APB_CYC			4		// đọc/ghi thanh ghi ngoại vi
+#define SIM_IRQ_CYC			12		// vào hoặc ra ngắt
+#define SIM_HAL_CALL_CYC	150		// một hàm HAL khởi động giao dịch
+
+/* FSMC bank 1 NE1 như MX_FSMC_Init, mode A: một lần truy cập tốn
+ * ADDSET + DATAST + 1 chu kỳ HCLK (ghi theo ExtTiming, đọc theo Timing) */
+#define SIM_FSMC_WR_CYC		(8 + 9 + 1)
+#define SIM_FSMC_RD_CYC		(15 + 60 + 1)
+
+/* ============ Thời gian ============ */
+extern uint64_t sim_ps;					// thời điểm hiện tại
+extern uint64_t sim_sleep_ps;			// tổng thời gian trong WFI
+
+void     sim_cycles(uint32_t n);			// CPU bận n chu kỳ HCLK
+void     sim_busy_ps(uint64_t dt);		// CPU quay chờ dt (ngắt vẫn chạy)
+uint64_t sim_cycles_total(void);		// chu kỳ HCLK kể từ lúc khởi động
+
+/* ============ Đồng hồ (từ RCC) ============ */
+uint32_t sim_sysclk_hz(void);
+uint32_t sim_hclk_hz(void);
+uint32_t sim_pclk1_hz(void);
+uint32_t sim_pclk2_hz(void);
+uint32_t sim_tim2clk_hz(void);
+
+/* ============ Nguồn sự kiện ============
+ * update(): đưa mô hình tới sim_ps (áp ghi thanh ghi, phát ngắt);
+ * trả về thời điểm sự kiện kế tiếp (> sim_ps) hoặc SIM_NEVER. */
+typedef uint64_t (*sim_update_fn)(void);
+int  sim_dev_add(sim_update_fn update);
+void sim_dev_kick(int dev);				// mô hình vừa đổi lịch: tính lại ngay
+/* Truy cập struct thanh ghi của dev: áp ghi của lần truy cập trước, cho
+ * thời gian trôi, đồng bộ dev rồi hẹn áp ghi của lần này ở lần kế */
+void sim_access(int dev, uint32_t cyc);
+void sim_flush(void);
+
+/* ============ Ngắt ============ */
+void sim_irq_set(IRQn_Type n);
+void sim_irq_clear(IRQn_Type n);
+void sim_dispatch(void);
+extern uint32_t sim_irq_count;
+
+/* ============ GPIO ============ */
+void sim_gpio_drive(GPIO_TypeDef *port, uint16_t pin, GPIO_PinState level);	// chân vào từ mô hình
+typedef void (*sim_pin_hook_t)(GPIO_PinState level);
+void sim_gpio_on_write(GPIO_TypeDef *port, uint16_t pin, sim_pin_hook_t hook);
+
+/* ============ Board (main.c) ============ */
+void sim_board_init(uint32_t utc, int32_t ppm);		// MX_*_Init
+void sim_firmware_init(void);						// USER CODE 2
+void sim_main_step(void);							// một vòng while(1)
+/* Kênh ra của __io_putchar (syscalls.c _write) vào file; không mở thì bỏ */
+bool sim_putchar_open(const char *path);
+
+/* ============ Mô hình ============ */
+void     sim_core_init(void);
+void     sim_lcd_init(void);
+void     sim_ds3231_init(uint32_t utc, int32_t ppm);
+void     sim_button_init(void);
+
+/* LCD: khung hình và thống kê bus. sim_lcd_sync ghi nhận thao tác cuối
+ * (lcd.c chỉ lộ nó ở lần lấy LCD kế) để đọc sim_lcd_stats cho đủ */
+void     sim_lcd_sync(void);
+uint16_t sim_lcd_pixel(uint16_t x, uint16_t y);
+/* Đọc một ký tự font sizey tại (x, y); 0 nếu không khớp ký tự nào.
+ * Bản _clip chỉ so các cột < x_end (ô bị chữ khác vẽ đè một phần) */
+char     sim_lcd_char(uint16_t x, uint16_t y, uint8_t sizey);
+char     sim_lcd_char_clip(uint16_t x, uint16_t y, uint8_t sizey, uint16_t x_end);
+void     sim_lcd_str(uint16_t x, uint16_t y, uint8_t sizey, uint8_t n, char *out);
+typedef struct {
+	uint64_t data_writes;
+	uint64_t cmd_writes;
+	uint64_t reads;
+	uint64_t ram_writes;	// điểm ảnh ghi qua 0x2C
+	uint64_t bus_ps;		// thời gian bus FSMC bận
+} sim_lcd_stats_t;
+extern sim_lcd_stats_t sim_lcd_stats;
+
+/* DS3231: giây UTC từ 2000-01-01 của chip và mốc lật giây kế tiếp */
+uint32_t sim_ds3231_utc(void);
+uint64_t sim_ds3231_next_tick_ps(void);
+uint8_t  sim_ds3231_reg(uint8_t reg);
+extern uint32_t sim_i2c_xfers;
+/* Số lần Alarm1 khớp khi A1IE bật (INT kéo thấp) và giây UTC lần gần nhất */
+extern uint32_t sim_ds3231_a1_fires;
+extern uint32_t sim_ds3231_a1_utc;
+
+/* Nút: giữ/nhả theo chỉ số logic (button_count[idx]) */
+void     sim_button_set(uint8_t idx, bool pressed);
+extern uint32_t sim_spi_xfers;
+
+#endif /* HOST_SIM_SIM_H_ */
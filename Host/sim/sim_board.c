@@ -0,0 +1,104 @@
+/*
+ * sim_board.c
+ *
+ *  Phần của main.c mà mọi chương trình trên máy tính cần: dựng board như
+ *  MX_*_Init, khởi động firmware như USER CODE 2 và một vòng của vòng lặp
+ *  chính. Harness (sim_main.c) và benchmark (Host/bench) cùng dùng.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "sim.h"
+#include "app_clock.h"
+#include "button.h"
+#include "clock_gov.h"
+#include "ds3231.h"
+#include "lcd.h"
+#include "prof.h"
+#include "sched.h"
+#include "software_timer.h"
+#include "trace.h"
+#include "dlog.h"
+#include "workq.h"
+
+void Error_Handler(void){
+	fprintf(stderr, "Error_Handler tại %.6f s\n", (double)sim_ps / SIM_PS_PER_S);
+	exit(2);
+}
+
+/* syscalls.c: _write đi từng byte qua __io_putchar */
+static FILE *putchar_file;
+
+bool sim_putchar_open(const char *path){
+	return (putchar_file = fopen(path, "wb")) != NULL;
+}
+
+int __io_putchar(int ch){
+	if(putchar_file) fputc(ch, putchar_file);
+	return ch;
+}
+
+int _write(int file, char *ptr, int len){
+	(void)file;
+	for(int i = 0; i < len; i++) __io_putchar(ptr[i]);
+	return len;
+}
+
+/* main.c: MX_*_Init */
+void sim_board_init(uint32_t utc, int32_t ppm){
+	sim_core_init();
+	sim_lcd_init();
+	sim_ds3231_init(utc, ppm);
+	sim_button_init();
+
+	HAL_NVIC_SetPriority(PendSV_IRQn, 15, 0);			// HAL_MspInit
+	HAL_NVIC_SetPriority(DMA1_Stream0_IRQn, 1, 0);		// MX_DMA_Init
+	HAL_NVIC_EnableIRQ(DMA1_Stream0_IRQn);
+	HAL_NVIC_SetPriority(DMA1_Stream6_IRQn, 1, 0);
+	HAL_NVIC_EnableIRQ(DMA1_Stream6_IRQn);
+
+	hi2c1.Instance = I2C1;
+	hi2c1.Init.ClockSpeed = 400000;
+	hi2c1.hdmarx = &hdma_i2c1_rx;
+	hi2c1.hdmatx = &hdma_i2c1_tx;
+	if(HAL_I2C_Init(&hi2c1) != HAL_OK) Error_Handler();
+
+	hspi1.Instance = SPI1;
+	hspi1.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_2;
+	if(HAL_SPI_Init(&hspi1) != HAL_OK) Error_Handler();
+
+	htim2.Instance = TIM2;
+	htim2.Init.Prescaler = 84 - 1;
+	htim2.Init.Period = 0xFFFFFFFFu;
+	HAL_NVIC_SetPriority(TIM2_IRQn, 0, 0);
+	HAL_NVIC_EnableIRQ(TIM2_IRQn);
+}
+
+/* main.c USER CODE 2 */
+void sim_firmware_init(void){
+	prof_init();
+	trace_init();
+	dlog_init();
+	workq_init();
+	lcd_init();
+	ds3231_init();
+	button_init();
+	timer_init();
+	clk_gov_init();
+	sched_init();
+	app_clock_init();
+	sched_run();
+	sched_reset_stats();
+}
+
+/* main.c: một vòng while(1) */
+void sim_main_step(void){
+	clk_gov_idle();
+	timer_sleep_until_event();
+	stimer_process();
+	if(flag_oneshot){
+		flag_oneshot = 0;
+		app_clock_on_second();
+	}
+	sched_run();
+	dlog_flush();
+}
@@ -0,0 +1,110 @@
+/*
+ * sim_button.c
+ *
+ *  SPI1 (HAL_SPI_Receive_IT) và chuỗi 74HC165 của bàn phím 4x4.
+ *  Trạng thái nút được chốt ở cạnh lên của BTN_LOAD. Bit ra là ánh xạ
+ *  ngược của bảng trong button_decode(): nút nhấn = 0 (kéo lên, tích cực
+ *  thấp), nên harness bấm theo chỉ số logic giống button_count[idx].
+ */
+#include <string.h>
+#include "sim.h"
+
+#define SPI_IRQ_CYC			60		// hai lần RXNE và phần kết thúc của HAL
+
+uint32_t sim_spi_xfers = 0;
+SPI_TypeDef sim_spi1;
+
+static uint16_t pressed = 0;		// bit idx = nút idx đang giữ
+static uint16_t latched = 0xFFFF;	// từ đã chốt, theo thứ tự bit button_decode đọc
+static uint32_t spi_br = 0;			// BR[2:0] từ lần HAL_SPI_Init gần nhất
+static int spi_dev;
+
+static struct {
+	bool active, irq;
+	uint8_t *buf;
+	uint16_t len;
+	uint64_t done_ps;
+} x;
+
+/* Bit (15 - i) của từ đọc được là nút map(i) trong button_decode */
+static int decode_index(int i){
+	if(i <= 3) return i + 4;
+	if(i <= 7) return 7 - i;
+	if(i <= 11) return i + 4;
+	return 23 - i;
+}
+
+static void on_load(GPIO_PinState level){
+	uint16_t w = 0;
+	if(!level) return;
+	for(int i = 0; i < 16; i++){
+		if(!(pressed & (1u << decode_index(i)))) w |= (uint16_t)(0x8000u >> i);
+	}
+	latched = w;
+}
+
+void sim_button_set(uint8_t idx, bool on){
+	if(on) pressed |= (uint16_t)(1u << idx);
+	else pressed &= (uint16_t)~(1u << idx);
+}
+
+static uint64_t spi_update(void){
+	if(!x.active) return SIM_NEVER;
+	if(x.done_ps > sim_ps) return x.done_ps;
+	x.active = false;
+	/* Khung 8 bit, MSB trước; spi_button là uint16 little-endian */
+	x.buf[0] = (uint8_t)(latched & 0xFF);
+	if(x.len > 1) x.buf[1] = (uint8_t)(latched >> 8);
+	x.irq = true;
+	sim_irq_set(SPI1_IRQn);
+	return SIM_NEVER;
+}
+
+void HAL_SPI_IRQHandler(SPI_HandleTypeDef *hspi){
+	if(!x.irq) return;
+	x.irq = false;
+	sim_cycles(SPI_IRQ_CYC);
+	hspi->State = HAL_SPI_STATE_READY;
+	HAL_SPI_RxCpltCallback(hspi);
+}
+
+HAL_StatusTypeDef HAL_SPI_Init(SPI_HandleTypeDef *hspi){
+	sim_cycles(SIM_HAL_CALL_CYC);
+	spi_br = (hspi->Init.BaudRatePrescaler >> 3) & 7u;
+	/* HAL_SPI_MspInit */
+	HAL_NVIC_SetPriority(SPI1_IRQn, 1, 0);
+	HAL_NVIC_EnableIRQ(SPI1_IRQn);
+	hspi->State = HAL_SPI_STATE_READY;
+	return HAL_OK;
+}
+
+HAL_SPI_StateTypeDef HAL_SPI_GetState(SPI_HandleTypeDef *hspi){
+	sim_cycles(2);
+	return hspi->State;
+}
+
+HAL_StatusTypeDef HAL_SPI_Receive_IT(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size){
+	uint32_t sck;
+	sim_cycles(SIM_HAL_CALL_CYC);
+	if(hspi->State != HAL_SPI_STATE_READY) return HAL_BUSY;
+	if(Size == 0 || Size > 2) return HAL_ERROR;
+	sim_spi_xfers++;
+	sck = sim_pclk2_hz() >> (spi_br + 1u);
+	x.active = true;
+	x.buf = pData;
+	x.len = Size;
+	x.done_ps = sim_ps + (uint64_t)Size * 8u * SIM_PS_PER_S / sck;
+	hspi->pRxBuffPtr = pData;
+	hspi->RxXferSize = Size;
+	hspi->State = HAL_SPI_STATE_BUSY_RX;
+	sim_dev_kick(spi_dev);
+	return HAL_OK;
+}
+
+void sim_button_init(void){
+	memset(&x, 0, sizeof(x));
+	pressed = 0;
+	latched = 0xFFFF;
+	sim_gpio_on_write(BTN_LOAD_GPIO_Port, BTN_LOAD_Pin, on_load);
+	spi_dev = sim_dev_add(spi_update);
+}
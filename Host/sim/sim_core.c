@@ -0,0 +1,657 @@
+/*
+ * sim_core.c
+ *
+ *  Thời gian, NVIC, RCC, TIM2, SCB/DWT và GPIO mô phỏng.
+ *
+ *  Ghi thanh ghi đi qua struct trong RAM nên mô hình không thấy ngay; mỗi
+ *  lần lấy con trỏ (TIM2, RCC, ...) là một lần truy cập bus: ghi của lần
+ *  truy cập trước được áp dụng (sim_flush), thời gian trôi, sự kiện đến hạn
+ *  được xử lý và ngắt đủ ưu tiên được chạy ngay tại đó.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+#include "stm32f4xx_it.h"
+
+uint64_t sim_ps = 0;
+uint64_t sim_sleep_ps = 0;
+uint32_t sim_irq_count = 0;
+
+/* ============ Nguồn sự kiện ============ */
+#define SIM_DEV_MAX 16
+
+static sim_update_fn dev_update[SIM_DEV_MAX];
+static uint64_t dev_next[SIM_DEV_MAX];
+static int dev_n = 0;
+static uint64_t next_ps = SIM_NEVER;
+static int flush_dev = -1;
+
+static void recompute_next(void){
+	uint64_t m = SIM_NEVER;
+	for(int i = 0; i < dev_n; i++) if(dev_next[i] < m) m = dev_next[i];
+	next_ps = m;
+}
+
+/* Trả về true nếu next_ps có thể đã thay đổi theo hướng muộn hơn */
+static bool dev_run(int d){
+	uint64_t t = dev_update[d](), old = dev_next[d];
+	if(t <= sim_ps){
+		fprintf(stderr, "sim: dev %d lên lịch lùi (%llu <= %llu)\n", d,
+		        (unsigned long long)t, (unsigned long long)sim_ps);
+		exit(3);
+	}
+	dev_next[d] = t;
+	if(t < next_ps) next_ps = t;
+	return t > old && old == next_ps;
+}
+
+int sim_dev_add(sim_update_fn update){
+	int d = dev_n++;
+	if(d >= SIM_DEV_MAX){
+		fprintf(stderr, "sim: quá %d nguồn sự kiện\n", SIM_DEV_MAX);
+		exit(3);
+	}
+	dev_update[d] = update;
+	dev_next[d] = SIM_NEVER;
+	dev_run(d);
+	return d;
+}
+
+void sim_dev_kick(int d){
+	if(dev_run(d)) recompute_next();
+}
+
+void sim_flush(void){
+	int d = flush_dev;
+	if(d < 0) return;
+	flush_dev = -1;
+	sim_dev_kick(d);
+}
+
+/* Đưa thời gian tới t, xử lý mọi sự kiện trên đường (không chạy ngắt) */
+static void run_until(uint64_t t){
+	while(next_ps <= t){
+		if(next_ps > sim_ps) sim_ps = next_ps;
+		for(int i = 0; i < dev_n; i++) if(dev_next[i] <= sim_ps) dev_run(i);
+		recompute_next();		// dev_run chỉ hạ next_ps, ở đây phải tính lại
+	}
+	if(t > sim_ps) sim_ps = t;
+}
+
+/* ============ Đồng hồ ============ */
+static RCC_TypeDef rcc, rcc_sh;
+static uint64_t pll_lock_ps = SIM_NEVER;
+static uint32_t hclk_cur = 168000000u;
+static uint64_t cyc_ps_q16;			// ps mỗi chu kỳ HCLK, 16 bit lẻ
+static uint32_t cyc_frac;
+static uint32_t rcc_gen = 0;		// tăng mỗi lần cấu hình clock đổi
+/* Đếm chu kỳ HCLK: mốc lại mỗi lần đổi clock */
+static uint64_t cyc_base = 0, cyc_base_ps = 0;
+
+/* Tách theo ms cho phép nhân không tràn 64 bit (HCLK chia hết cho 1000) */
+uint64_t sim_cycles_total(void){
+	uint64_t dt = sim_ps - cyc_base_ps;
+	return cyc_base + dt / SIM_PS_PER_MS * (hclk_cur / 1000u)
+	       + dt % SIM_PS_PER_MS * hclk_cur / SIM_PS_PER_S;
+}
+
+static void set_hclk(uint32_t hclk){
+	hclk_cur = hclk;
+	cyc_ps_q16 = (SIM_PS_PER_S << 16) / hclk;
+	cyc_frac = 0;
+}
+
+/* n chu kỳ HCLK ra ps, giữ phần lẻ cho lần sau */
+static uint64_t cyc_to_ps(uint32_t n){
+	uint64_t q = (uint64_t)n * cyc_ps_q16 + cyc_frac;
+	cyc_frac = (uint32_t)(q & 0xFFFFu);
+	return q >> 16;
+}
+
+static void rcc_apply(void){
+	uint32_t cr = rcc.CR, cfgr = rcc.CFGR;
+	uint32_t sws = (rcc_sh.CFGR & RCC_CFGR_SWS) >> RCC_CFGR_SWS_Pos;
+	uint32_t hclk;
+
+	if(!(cr & RCC_CR_PLLON) && sws == RCC_CFGR_SW_PLL) cr |= RCC_CR_PLLON;	// đang làm SYSCLK: không tắt được
+	if((cr & RCC_CR_PLLON) && !(rcc_sh.CR & RCC_CR_PLLON)){
+		pll_lock_ps = sim_ps + 100 * SIM_PS_PER_US;		// khoá ~100 µs
+		cr &= ~RCC_CR_PLLRDY;
+	} else if(!(cr & RCC_CR_PLLON)){
+		pll_lock_ps = SIM_NEVER;
+		cr &= ~RCC_CR_PLLRDY;
+	} else {
+		cr = (cr & ~RCC_CR_PLLRDY) | (rcc_sh.CR & RCC_CR_PLLRDY);	// bit chỉ đọc
+	}
+	if(pll_lock_ps <= sim_ps){
+		pll_lock_ps = SIM_NEVER;
+		cr |= RCC_CR_PLLRDY;
+	}
+	/* SW -> SWS ngay nếu nguồn đã sẵn sàng */
+	if((cfgr & RCC_CFGR_SW) != RCC_CFGR_SW_PLL || (cr & RCC_CR_PLLRDY)) sws = cfgr & RCC_CFGR_SW;
+	cfgr = (cfgr & ~RCC_CFGR_SWS) | (sws << RCC_CFGR_SWS_Pos);
+
+	rcc.CR = cr;
+	rcc.CFGR = cfgr;
+	rcc_sh = rcc;
+	rcc_gen++;
+
+	hclk = sim_hclk_hz();
+	if(hclk != hclk_cur){
+		cyc_base = sim_cycles_total();
+		cyc_base_ps = sim_ps;
+		set_hclk(hclk);
+	}
+}
+
+static void rcc_sync(void){
+	if(rcc.CR != rcc_sh.CR || rcc.CFGR != rcc_sh.CFGR || pll_lock_ps <= sim_ps) rcc_apply();
+}
+
+static uint64_t rcc_update(void){
+	rcc_sync();
+	return pll_lock_ps;
+}
+
+static const uint16_t ahb_div[16] = { 1,1,1,1,1,1,1,1, 2,4,8,16,64,128,256,512 };
+static const uint8_t  apb_div[8]  = { 1,1,1,1, 2,4,8,16 };
+
+uint32_t sim_sysclk_hz(void){
+	return ((rcc_sh.CFGR & RCC_CFGR_SWS) >> RCC_CFGR_SWS_Pos) == RCC_CFGR_SW_PLL ? 168000000u : 16000000u;
+}
+
+uint32_t sim_hclk_hz(void){
+	return sim_sysclk_hz() / ahb_div[(rcc_sh.CFGR >> 4) & 0xF];
+}
+
+uint32_t sim_pclk1_hz(void){
+	return sim_hclk_hz() / apb_div[(rcc_sh.CFGR >> 10) & 0x7];
+}
+
+uint32_t sim_pclk2_hz(void){
+	return sim_hclk_hz() / apb_div[(rcc_sh.CFGR >> 13) & 0x7];
+}
+
+uint32_t sim_tim2clk_hz(void){
+	uint32_t d = apb_div[(rcc_sh.CFGR >> 10) & 0x7];
+	return d == 1 ? sim_pclk1_hz() : sim_pclk1_hz() * 2u;
+}
+
+static int rcc_dev;
+
+RCC_TypeDef *sim_rcc(void){
+	sim_access(rcc_dev, SIM_APB_CYC);
+	return &rcc;
+}
+
+uint32_t SystemCoreClock = 16000000u;
+
+void SystemCoreClockUpdate(void){
+	rcc_sync();
+	SystemCoreClock = sim_hclk_hz();
+}
+
+uint32_t HAL_RCC_GetHCLKFreq(void)  { rcc_sync(); return sim_hclk_hz(); }
+uint32_t HAL_RCC_GetPCLK1Freq(void) { rcc_sync(); return sim_pclk1_hz(); }
+uint32_t HAL_RCC_GetPCLK2Freq(void) { rcc_sync(); return sim_pclk2_hz(); }
+
+/* ============ CPU ============ */
+static void advance(uint64_t dt){
+	run_until(sim_ps + dt);
+}
+
+static uint32_t primask = 0;
+static uint32_t pend_count = 0;
+
+void sim_cycles(uint32_t n){
+	sim_flush();
+	rcc_sync();
+	advance(cyc_to_ps(n));
+	if(!primask && pend_count) sim_dispatch();
+}
+
+void sim_access(int dev, uint32_t cyc){
+	sim_cycles(cyc);
+	sim_dev_kick(dev);
+	flush_dev = dev;
+}
+
+void sim_busy_ps(uint64_t dt){
+	uint64_t t = sim_ps + dt;
+	sim_flush();
+	while(sim_ps < t){
+		run_until(next_ps < t ? next_ps : t);
+		sim_dispatch();
+	}
+}
+
+/* ============ NVIC ============ */
+typedef struct {
+	IRQn_Type n;
+	void (*handler)(void);
+	uint8_t prio;
+	bool en, pend;
+} sim_irq_t;
+
+/* Theo số exception: cùng mức ưu tiên thì số nhỏ hơn chạy trước */
+static sim_irq_t irqs[] = {
+	{ PendSV_IRQn,       PendSV_Handler,          0, true,  false },
+	{ EXTI0_IRQn,        EXTI0_IRQHandler,        0, false, false },
+	{ DMA1_Stream0_IRQn, DMA1_Stream0_IRQHandler, 0, false, false },
+	{ DMA1_Stream6_IRQn, DMA1_Stream6_IRQHandler, 0, false, false },
+	{ TIM2_IRQn,         TIM2_IRQHandler,         0, false, false },
+	{ I2C1_EV_IRQn,      I2C1_EV_IRQHandler,      0, false, false },
+	{ I2C1_ER_IRQn,      I2C1_ER_IRQHandler,      0, false, false },
+	{ SPI1_IRQn,         SPI1_IRQHandler,         0, false, false },
+};
+#define SIM_IRQ_N (sizeof(irqs) / sizeof(irqs[0]))
+
+static int exec_prio = 256;			// luồng chính
+
+#define SIM_IRQ_SLOTS 64
+static sim_irq_t *irq_slot[SIM_IRQ_SLOTS];		// theo IRQn + 16
+
+static sim_irq_t *irq_find(IRQn_Type n){
+	unsigned k = (unsigned)(n + 16);
+	if(k < SIM_IRQ_SLOTS && irq_slot[k]) return irq_slot[k];
+	for(unsigned i = 0; i < SIM_IRQ_N; i++){
+		if(irqs[i].n == n && k < SIM_IRQ_SLOTS) return irq_slot[k] = &irqs[i];
+	}
+	fprintf(stderr, "sim: IRQ %d không có trong mô hình\n", (int)n);
+	exit(3);
+}
+
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority){
+	(void)SubPriority;
+	irq_find(IRQn)->prio = (uint8_t)PreemptPriority;
+}
+
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn){
+	irq_find(IRQn)->en = true;
+	sim_dispatch();
+}
+
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn){
+	irq_find(IRQn)->en = false;
+}
+
+void sim_irq_set(IRQn_Type n){
+	sim_irq_t *q = irq_find(n);
+	if(!q->pend){ q->pend = true; pend_count++; }
+}
+
+void sim_irq_clear(IRQn_Type n){
+	sim_irq_t *q = irq_find(n);
+	if(q->pend){ q->pend = false; pend_count--; }
+}
+
+static sim_irq_t *irq_best(void){
+	sim_irq_t *best = NULL;
+	if(!pend_count) return NULL;
+	for(unsigned i = 0; i < SIM_IRQ_N; i++){
+		sim_irq_t *q = &irqs[i];
+		if(q->pend && q->en && q->prio < exec_prio && (!best || q->prio < best->prio)) best = q;
+	}
+	return best;
+}
+
+void sim_dispatch(void){
+	sim_irq_t *q;
+	int saved;
+	while(!primask && pend_count){
+		sim_flush();
+		q = irq_best();
+		if(!q) return;
+		q->pend = false;
+		pend_count--;
+		saved = exec_prio;
+		exec_prio = q->prio;
+		sim_irq_count++;
+		advance(cyc_to_ps(SIM_IRQ_CYC));
+		q->handler();
+		sim_flush();
+		advance(cyc_to_ps(SIM_IRQ_CYC));
+		exec_prio = saved;
+	}
+}
+
+void sim_disable_irq(void){
+	primask = 1;
+}
+
+void sim_enable_irq(void){
+	primask = 0;
+	sim_dispatch();
+}
+
+uint32_t sim_get_primask(void){
+	return primask;
+}
+
+void sim_set_primask(uint32_t m){
+	primask = m & 1u;
+	if(!primask) sim_dispatch();
+}
+
+/* WFI: ngủ tới khi có ngắt đủ ưu tiên chờ (PRIMASK không chặn việc thức dậy) */
+void sim_wfi(void){
+	uint64_t t0;
+	sim_flush();
+	t0 = sim_ps;
+	while(!irq_best()){
+		if(next_ps == SIM_NEVER){
+			fprintf(stderr, "sim: WFI mà không còn sự kiện nào\n");
+			exit(3);
+		}
+		run_until(next_ps);
+	}
+	sim_sleep_ps += sim_ps - t0;
+}
+
+/* ============ TIM2 ============
+ * Bộ đếm 64 bit ảo; CNT là 32 bit thấp. Cờ được bật khi bộ đếm đi qua
+ * CCRx hoặc tràn về 0, kể cả khi ngắt tương ứng đang tắt (đọc cờ vẫn đúng). */
+static TIM_TypeDef t2, t2_sh;
+static uint64_t t2_base_ps, t2_base_n, t2_n, t2_tick_ps, t2_tick_inv;
+static uint64_t t2_flag_n, t2_next_ps;		// lần đếm tới cờ chưa bật gần nhất; sự kiện kế
+static uint32_t t2_clk, t2_psc, t2_gen;
+static int tim2_dev;
+
+static void tim2_rebase(uint64_t n){
+	t2_base_ps = sim_ps;
+	t2_base_n = n;
+	t2_n = n;
+}
+
+static void tim2_retick(void){
+	t2_tick_ps = (uint64_t)(t2_psc + 1u) * SIM_PS_PER_S / t2_clk;
+	t2_tick_inv = UINT64_MAX / t2_tick_ps;
+}
+
+/* ps / t2_tick_ps bằng phép nhân nghịch đảo (chia 64 bit nằm trên đường nóng) */
+static uint64_t tim2_ticks(uint64_t ps){
+	uint64_t q = (uint64_t)(((unsigned __int128)ps * t2_tick_inv) >> 64);
+	while((q + 1u) * t2_tick_ps <= ps) q++;
+	return q;
+}
+
+/* Lần đầu bộ đếm (sau from) có 32 bit thấp bằng target */
+static uint64_t tim2_first(uint64_t from, uint32_t target){
+	uint64_t d = (uint32_t)(target - (uint32_t)from);
+	return from + (d ? d : 0x100000000ull);
+}
+
+static uint32_t tim2_crossed(uint64_t from, uint64_t to){
+	uint32_t sr = 0;
+	if(to <= from) return 0;
+	if(tim2_first(from, 0) <= to)       sr |= TIM_SR_UIF;
+	if(tim2_first(from, t2.CCR1) <= to) sr |= TIM_SR_CC1IF;
+	if(tim2_first(from, t2.CCR2) <= to) sr |= TIM_SR_CC2IF;
+	return sr;
+}
+
+static uint64_t tim2_update(void){
+	uint32_t sr = t2_sh.SR, clk;
+	uint64_t n, next = SIM_NEVER;
+
+	rcc_sync();
+	/* 1) Đếm tới hiện tại theo cấu hình cũ */
+	n = t2_base_n + tim2_ticks(sim_ps - t2_base_ps);
+	/* Phần lớn truy cập chỉ đọc CNT: không có ghi, clock không đổi, chưa tới cờ nào */
+	if(n < t2_flag_n && t2_gen == rcc_gen && !memcmp(&t2, &t2_sh, sizeof(t2))){
+		t2_n = n;
+		t2.CNT = t2_sh.CNT = (uint32_t)n;
+		return t2_next_ps;
+	}
+	t2_gen = rcc_gen;
+	sr |= tim2_crossed(t2_n, n);
+	t2_n = n;
+
+	/* 2) Áp ghi của lần truy cập trước */
+	if(t2.SR != t2_sh.SR) sr &= t2.SR;					// rc_w0
+	clk = sim_tim2clk_hz();
+	if(clk != t2_clk){									// bộ chia bắt đầu lại theo xung mới
+		t2_clk = clk;
+		tim2_retick();
+		tim2_rebase(t2_n);
+	}
+	if(t2.CNT != t2_sh.CNT) tim2_rebase((t2_n & ~0xFFFFFFFFull) | t2.CNT);
+	if(t2.EGR){
+		if(t2.EGR & TIM_EGR_UG){
+			t2_psc = t2.PSC;
+			tim2_retick();
+			tim2_rebase(t2_n & ~0xFFFFFFFFull);
+			if(!(t2.CR1 & TIM_CR1_URS)) sr |= TIM_SR_UIF;
+		}
+		if(t2.EGR & TIM_EGR_CC1G) sr |= TIM_SR_CC1IF;
+		if(t2.EGR & TIM_EGR_CC2G) sr |= TIM_SR_CC2IF;
+		t2.EGR = 0;
+	}
+
+	/* 3) Công bố */
+	t2.CNT = (uint32_t)t2_n;
+	t2.SR = sr;
+	t2_sh = t2;
+	if(sr & t2.DIER & 7u) sim_irq_set(TIM2_IRQn);
+	else sim_irq_clear(TIM2_IRQn);
+
+	/* Cờ chưa bật gần nhất (kể cả nguồn không bật ngắt, để đường nhanh không bỏ sót) */
+	t2_flag_n = UINT64_MAX;
+	if(!(sr & TIM_SR_UIF)) t2_flag_n = tim2_first(t2_n, 0);
+	if(!(sr & TIM_SR_CC1IF) && tim2_first(t2_n, t2.CCR1) < t2_flag_n) t2_flag_n = tim2_first(t2_n, t2.CCR1);
+	if(!(sr & TIM_SR_CC2IF) && tim2_first(t2_n, t2.CCR2) < t2_flag_n) t2_flag_n = tim2_first(t2_n, t2.CCR2);
+
+	/* Sự kiện kế: nguồn có ngắt bật mà cờ chưa lên */
+	if((t2.DIER & TIM_IT_UPDATE) && !(sr & TIM_SR_UIF)){
+		uint64_t k = tim2_first(t2_n, 0);
+		if(k - t2_base_n < SIM_NEVER / t2_tick_ps) next = t2_base_ps + (k - t2_base_n) * t2_tick_ps;
+	}
+	if((t2.DIER & TIM_IT_CC1) && !(sr & TIM_SR_CC1IF)){
+		uint64_t t = t2_base_ps + (tim2_first(t2_n, t2.CCR1) - t2_base_n) * t2_tick_ps;
+		if(t < next) next = t;
+	}
+	if((t2.DIER & TIM_IT_CC2) && !(sr & TIM_SR_CC2IF)){
+		uint64_t t = t2_base_ps + (tim2_first(t2_n, t2.CCR2) - t2_base_n) * t2_tick_ps;
+		if(t < next) next = t;
+	}
+	t2_next_ps = next;
+	return next;
+}
+
+TIM_TypeDef *sim_tim2(void){
+	sim_access(tim2_dev, SIM_APB_CYC);
+	return &t2;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef *htim){
+	(void)htim;
+	TIM2->DIER |= TIM_IT_UPDATE;
+	sim_flush();
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_OC_Start_IT(TIM_HandleTypeDef *htim, uint32_t Channel){
+	(void)htim;
+	TIM2->DIER |= (Channel == TIM_CHANNEL_1) ? TIM_IT_CC1 : TIM_IT_CC2;
+	sim_flush();
+	return HAL_OK;
+}
+
+/* Như HAL_TIM_IRQHandler: xoá cờ rồi gọi callback theo kênh */
+void HAL_TIM_IRQHandler(TIM_HandleTypeDef *htim){
+	if((TIM2->SR & TIM_SR_CC1IF) && (TIM2->DIER & TIM_IT_CC1)){
+		TIM2->SR = ~TIM_SR_CC1IF;
+		htim->Channel = HAL_TIM_ACTIVE_CHANNEL_1;
+		HAL_TIM_OC_DelayElapsedCallback(htim);
+		htim->Channel = HAL_TIM_ACTIVE_CHANNEL_CLEARED;
+	}
+	if((TIM2->SR & TIM_SR_CC2IF) && (TIM2->DIER & TIM_IT_CC2)){
+		TIM2->SR = ~TIM_SR_CC2IF;
+		htim->Channel = HAL_TIM_ACTIVE_CHANNEL_2;
+		HAL_TIM_OC_DelayElapsedCallback(htim);
+		htim->Channel = HAL_TIM_ACTIVE_CHANNEL_CLEARED;
+	}
+	if((TIM2->SR & TIM_SR_UIF) && (TIM2->DIER & TIM_IT_UPDATE)){
+		TIM2->SR = ~TIM_SR_UIF;
+		HAL_TIM_PeriodElapsedCallback(htim);
+	}
+}
+
+/* ============ SCB / DWT / debug ============ */
+static SCB_Type scb;
+static int scb_dev;
+
+static uint64_t scb_update(void){
+	if(scb.ICSR & SCB_ICSR_PENDSVSET_Msk) sim_irq_set(PendSV_IRQn);
+	scb.ICSR = 0;
+	return SIM_NEVER;
+}
+
+SCB_Type *sim_scb(void){
+	sim_access(scb_dev, SIM_APB_CYC);
+	return &scb;
+}
+
+static DWT_Type dwt, dwt_sh;
+static uint64_t dwt_offset = 0;
+static int dwt_dev;
+
+static uint64_t dwt_update(void){
+	uint64_t c = sim_cycles_total();
+	if(dwt.CYCCNT != dwt_sh.CYCCNT) dwt_offset = c - dwt.CYCCNT;
+	if(dwt.CTRL & DWT_CTRL_CYCCNTENA_Msk) dwt.CYCCNT = (uint32_t)(c - dwt_offset);
+	dwt_sh = dwt;
+	return SIM_NEVER;
+}
+
+DWT_Type *sim_dwt(void){
+	sim_access(dwt_dev, 1);
+	return &dwt;
+}
+
+static CoreDebug_Type coredebug;
+static DBGMCU_TypeDef dbgmcu;
+
+CoreDebug_Type *sim_coredebug(void){
+	sim_cycles(SIM_APB_CYC);
+	return &coredebug;
+}
+
+DBGMCU_TypeDef *sim_dbgmcu(void){
+	sim_cycles(SIM_APB_CYC);
+	return &dbgmcu;
+}
+
+/* ============ SysTick / HAL tick ============ */
+__IO uint32_t uwTick = 0;
+static uint64_t systick_next = SIM_PS_PER_MS;
+static bool systick_on = true;
+static int systick_dev;
+
+static uint64_t systick_update(void){
+	if(!systick_on) return SIM_NEVER;
+	while(systick_next <= sim_ps){
+		uwTick++;
+		systick_next += SIM_PS_PER_MS;
+	}
+	return systick_next;
+}
+
+void HAL_IncTick(void){
+	uwTick++;
+}
+
+void HAL_SuspendTick(void){
+	systick_on = false;
+	sim_dev_kick(systick_dev);
+}
+
+void HAL_ResumeTick(void){
+	systick_on = true;
+	systick_next = (sim_ps / SIM_PS_PER_MS + 1u) * SIM_PS_PER_MS;
+	sim_dev_kick(systick_dev);
+}
+
+void HAL_Delay(uint32_t Delay){
+	sim_busy_ps((uint64_t)(Delay + 1u) * SIM_PS_PER_MS);
+}
+
+/* ============ GPIO / EXTI ============ */
+GPIO_TypeDef sim_gpio[7] = { {0}, {1}, {2}, {3}, {4}, {5}, {6} };
+static sim_pin_hook_t pin_hook[7][16];
+static uint16_t exti_falling = 0;
+static uint8_t exti_port[16];
+
+static int pin_no(uint16_t pin){
+	return __builtin_ctz(pin);
+}
+
+void sim_gpio_on_write(GPIO_TypeDef *port, uint16_t pin, sim_pin_hook_t hook){
+	pin_hook[port->port][pin_no(pin)] = hook;
+}
+
+void sim_gpio_drive(GPIO_TypeDef *port, uint16_t pin, GPIO_PinState level){
+	uint32_t old = port->IDR;
+	int k = pin_no(pin);
+	if(level) port->IDR |= pin;
+	else port->IDR &= ~(uint32_t)pin;
+	if((old & pin) && !level && (exti_falling & pin) && exti_port[k] == port->port){
+		if(k == 0) sim_irq_set(EXTI0_IRQn);
+	}
+}
+
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init){
+	for(int k = 0; k < 16; k++){
+		if(!(GPIO_Init->Pin & (1u << k))) continue;
+		if(GPIO_Init->Mode == GPIO_MODE_IT_FALLING){
+			exti_falling |= (uint16_t)(1u << k);
+			exti_port[k] = (uint8_t)GPIOx->port;
+		}
+	}
+	sim_cycles(SIM_HAL_CALL_CYC);
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState){
+	sim_pin_hook_t hook = pin_hook[GPIOx->port][pin_no(GPIO_Pin)];
+	sim_cycles(SIM_APB_CYC);
+	if(PinState) GPIOx->ODR |= GPIO_Pin;
+	else GPIOx->ODR &= ~(uint32_t)GPIO_Pin;
+	if(hook) hook(PinState);
+}
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin){
+	sim_cycles(SIM_APB_CYC);
+	return (GPIOx->IDR & GPIO_Pin) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
+
+void HAL_GPIO_EXTI_IRQHandler(uint16_t GPIO_Pin){
+	sim_cycles(SIM_APB_CYC);		// xoá EXTI->PR
+	HAL_GPIO_EXTI_Callback(GPIO_Pin);
+}
+
+/* ============ Khởi động ============
+ * Như sau SystemClock_Config: PLL 168 MHz, AHB/1, APB1/4, APB2/4 */
+void sim_core_init(void){
+	rcc.CR = RCC_CR_PLLON | RCC_CR_PLLRDY;
+	rcc.CFGR = RCC_CFGR_SW_PLL | (RCC_CFGR_SW_PLL << RCC_CFGR_SWS_Pos)
+	         | RCC_CFGR_HPRE_DIV1 | RCC_CFGR_PPRE1_DIV4 | RCC_CFGR_PPRE2_DIV4;
+	rcc_sh = rcc;
+	set_hclk(sim_hclk_hz());
+	SystemCoreClock = hclk_cur;
+	rcc_dev = sim_dev_add(rcc_update);
+
+	/* MX_TIM2_Init: PSC 83, ARR tối đa */
+	t2.PSC = 83;
+	t2.ARR = 0xFFFFFFFFu;
+	t2_psc = t2.PSC;
+	t2_clk = sim_tim2clk_hz();
+	tim2_retick();
+	tim2_rebase(0);
+	t2_sh = t2;
+	tim2_dev = sim_dev_add(tim2_update);
+
+	scb_dev = sim_dev_add(scb_update);
+	dwt_dev = sim_dev_add(dwt_update);
+	systick_dev = sim_dev_add(systick_update);
+}
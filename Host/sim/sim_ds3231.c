@@ -0,0 +1,338 @@
+/*
+ * sim_ds3231.c
+ *
+ *  I2C1 (HAL blocking/IT/DMA) và DS3231 trên bus.
+ *
+ *  DS3231: đếm giây UTC với sai số ppm, thanh ghi thời gian BCD, Alarm1/2
+ *  so khớp theo mặt nạ A1Mx/A2Mx mỗi lần lật giây, cờ A1F/A2F chỉ xoá được
+ *  bằng ghi 0, chân INT kéo thấp khi INTCN và cờ + bit cho phép cùng bật.
+ *  Ghi thanh ghi giây đặt lại chuỗi chia (giây kế tiếp sau đúng 1 s).
+ *  Dữ liệu đọc được chốt lúc START như bộ đệm phụ của chip.
+ *
+ *  I2C: thời gian giao dịch theo số bit và SCL thực tế = PCLK1 hiện tại /
+ *  (3 x CCR), CCR tính ở lần HAL_I2C_Init gần nhất (đổi PCLK1 mà không init
+ *  lại thì SCL lệch như trên chip).
+ */
+#include <string.h>
+#include "sim.h"
+#include "calendar.h"
+#include "utils.h"
+
+#define DS_ADDR				0xD0
+#define DS_NREGS			0x13
+#define DS_CONTROL			0x0E
+#define DS_STATUS			0x0F
+#define DS_A1F				0x01
+#define DS_A2F				0x02
+#define DS_OSF				0x80
+#define DS_A1IE				0x01
+#define DS_A2IE				0x02
+#define DS_INTCN			0x04
+
+uint32_t sim_i2c_xfers = 0;
+uint32_t sim_ds3231_a1_fires = 0;
+uint32_t sim_ds3231_a1_utc = 0;
+
+static uint8_t regs[DS_NREGS];
+static uint32_t ds_utc;
+static uint64_t ds_next;
+static uint64_t ds_period;
+static int ds_dev;
+
+/* ============ DS3231 ============ */
+static void ds_encode_time(void){
+	ds3231_time_t t;
+	cal_from_sec(ds_utc, &t);
+	regs[0] = DEC2BCD(t.sec);
+	regs[1] = DEC2BCD(t.min);
+	regs[2] = DEC2BCD(t.hour);
+	/* regs[3] (thứ) là bộ đếm riêng 1..7, chỉ tăng lúc nửa đêm */
+	regs[4] = DEC2BCD(t.date);
+	regs[5] = DEC2BCD(t.month);
+	regs[6] = DEC2BCD(t.year);
+}
+
+static void ds_drive_int(void){
+	uint8_t c = regs[DS_CONTROL], s = regs[DS_STATUS];
+	bool low = (c & DS_INTCN) && (((s & DS_A1F) && (c & DS_A1IE)) || ((s & DS_A2F) && (c & DS_A2IE)));
+	sim_gpio_drive(RTC_SQW_GPIO_Port, RTC_SQW_Pin, low ? GPIO_PIN_RESET : GPIO_PIN_SET);
+}
+
+static bool ds_day_match(uint8_t r){
+	if(r & 0x40) return (r & 0x0F) == regs[3];			// DY/DT = 1: thứ
+	return (r & 0x3F) == regs[4];
+}
+
+static void ds_check_alarms(void){
+	bool ms = (regs[7] & 0x7F) == regs[0];
+	bool mm = (regs[8] & 0x7F) == regs[1];
+	bool mh = (regs[9] & 0x3F) == regs[2];
+	bool a1 = ((regs[7] & 0x80) || ms) && ((regs[8] & 0x80) || mm) &&
+	          ((regs[9] & 0x80) || mh) && ((regs[10] & 0x80) || ds_day_match(regs[10]));
+	bool a2 = regs[0] == 0 &&
+	          ((regs[11] & 0x80) || (regs[11] & 0x7F) == regs[1]) &&
+	          ((regs[12] & 0x80) || (regs[12] & 0x3F) == regs[2]) &&
+	          ((regs[13] & 0x80) || ds_day_match(regs[13]));
+	if(a1) regs[DS_STATUS] |= DS_A1F;
+	if(a2) regs[DS_STATUS] |= DS_A2F;
+	if(a1 && (regs[DS_CONTROL] & DS_A1IE) && (regs[DS_CONTROL] & DS_INTCN)){
+		sim_ds3231_a1_fires++;
+		sim_ds3231_a1_utc = ds_utc;
+	}
+}
+
+static void ds_tick(void){
+	uint8_t date = regs[4];
+	ds_utc++;
+	ds_encode_time();
+	if(regs[4] != date) regs[3] = (uint8_t)(regs[3] % 7u + 1u);
+	ds_check_alarms();
+	ds_drive_int();
+}
+
+static uint64_t ds_update(void){
+	while(ds_next <= sim_ps){
+		ds_tick();
+		ds_next += ds_period;
+	}
+	return ds_next;
+}
+
+static void ds_read_regs(uint8_t reg, uint8_t *out, uint16_t len){
+	sim_dev_kick(ds_dev);
+	for(uint16_t i = 0; i < len; i++) out[i] = regs[(reg + i) % DS_NREGS];
+}
+
+static void ds_write_regs(uint8_t reg, const uint8_t *in, uint16_t len){
+	bool time_written = false, sec_written = false;
+	sim_dev_kick(ds_dev);
+	for(uint16_t i = 0; i < len; i++){
+		uint8_t a = (uint8_t)((reg + i) % DS_NREGS), v = in[i];
+		if(a == DS_STATUS){
+			/* A1F/A2F/OSF chỉ xoá được; BSY chỉ đọc */
+			uint8_t keep = regs[a] & (DS_A1F | DS_A2F | DS_OSF) & v;
+			v = (uint8_t)(keep | (v & 0x08) | (regs[a] & 0x04));
+		} else if(a == 0x11 || a == 0x12){
+			continue;										// nhiệt độ chỉ đọc
+		}
+		regs[a] = v;
+		if(a <= 6) time_written = true;
+		if(a == 0) sec_written = true;
+	}
+	if(time_written){
+		ds3231_time_t t = {
+			.sec = BCD2DEC(regs[0] & 0x7F), .min = BCD2DEC(regs[1] & 0x7F),
+			.hour = BCD2DEC(regs[2] & 0x3F), .day = regs[3] & 0x07,
+			.date = BCD2DEC(regs[4] & 0x3F), .month = BCD2DEC(regs[5] & 0x1F),
+			.year = BCD2DEC(regs[6]),
+		};
+		ds_utc = cal_to_sec(&t);
+		ds_encode_time();
+	}
+	if(sec_written){
+		ds_next = sim_ps + ds_period;
+		sim_dev_kick(ds_dev);
+	}
+	ds_drive_int();
+}
+
+uint32_t sim_ds3231_utc(void){
+	sim_dev_kick(ds_dev);
+	return ds_utc;
+}
+
+uint64_t sim_ds3231_next_tick_ps(void){
+	sim_dev_kick(ds_dev);
+	return ds_next;
+}
+
+uint8_t sim_ds3231_reg(uint8_t reg){
+	sim_dev_kick(ds_dev);
+	return regs[reg % DS_NREGS];
+}
+
+/* ============ I2C1 ============ */
+I2C_TypeDef sim_i2c1;
+
+static struct {
+	bool active, irq, write, dma, nack;
+	uint8_t reg;
+	uint8_t *buf;
+	uint16_t len;
+	uint8_t data[DS_NREGS];
+	uint64_t done_ps;
+} x;
+static uint32_t i2c_ccr = 35;
+static int i2c_dev;
+
+static uint64_t i2c_xfer_ps(uint16_t len, bool write){
+	uint32_t bits = write ? (2u + len) * 9u + 2u : (3u + len) * 9u + 3u;
+	uint32_t scl = sim_pclk1_hz() / (3u * i2c_ccr);
+	return (uint64_t)bits * SIM_PS_PER_S / scl;
+}
+
+static void i2c_raise(void){
+	x.irq = true;
+	if(x.nack) sim_irq_set(I2C1_ER_IRQn);
+	else if(!x.dma) sim_irq_set(I2C1_EV_IRQn);
+	else sim_irq_set(x.write ? DMA1_Stream6_IRQn : DMA1_Stream0_IRQn);
+}
+
+static uint64_t i2c_update(void){
+	if(!x.active) return SIM_NEVER;
+	if(x.done_ps > sim_ps) return x.done_ps;
+	x.active = false;
+	if(!x.nack){
+		if(x.write) ds_write_regs(x.reg, x.data, x.len);
+		else memcpy(x.buf, x.data, x.len);
+	}
+	i2c_raise();
+	return SIM_NEVER;
+}
+
+/* Kết thúc ở ISR: HAL đưa State về READY rồi mới gọi callback.
+ * IT: mỗi sự kiện EV (SB, ADDR, TXE địa chỉ thanh ghi, từng byte, BTF; đọc
+ * thêm SB/ADDR lần hai) là một lần vào ngắt; mô hình chỉ phát lần cuối nên
+ * tính gộp các lần trước vào đây */
+static void i2c_irq(void){
+	uint32_t ev;
+	if(!x.irq) return;
+	x.irq = false;
+	if(!x.dma && !x.nack){
+		ev = x.write ? x.len + 3u : x.len + 5u;
+		sim_irq_count += ev;
+		sim_cycles(ev * (2u * SIM_IRQ_CYC + 40u));
+	}
+	sim_cycles(40);
+	hi2c1.State = HAL_I2C_STATE_READY;
+	if(x.nack) HAL_I2C_ErrorCallback(&hi2c1);
+	else if(x.write) HAL_I2C_MemTxCpltCallback(&hi2c1);
+	else HAL_I2C_MemRxCpltCallback(&hi2c1);
+}
+
+void HAL_I2C_EV_IRQHandler(I2C_HandleTypeDef *hi2c) { (void)hi2c; i2c_irq(); }
+void HAL_I2C_ER_IRQHandler(I2C_HandleTypeDef *hi2c) { (void)hi2c; i2c_irq(); }
+void HAL_DMA_IRQHandler(DMA_HandleTypeDef *hdma)    { (void)hdma; i2c_irq(); }
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c){
+	uint32_t pclk1 = HAL_RCC_GetPCLK1Freq();
+	sim_cycles(SIM_HAL_CALL_CYC);
+	i2c_ccr = (pclk1 + 3u * hi2c->Init.ClockSpeed - 1u) / (3u * hi2c->Init.ClockSpeed);
+	if(i2c_ccr == 0) i2c_ccr = 1;
+	/* HAL_I2C_MspInit */
+	HAL_NVIC_SetPriority(I2C1_EV_IRQn, 1, 0);
+	HAL_NVIC_EnableIRQ(I2C1_EV_IRQn);
+	HAL_NVIC_SetPriority(I2C1_ER_IRQn, 1, 0);
+	HAL_NVIC_EnableIRQ(I2C1_ER_IRQn);
+	hi2c->State = HAL_I2C_STATE_READY;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef *hi2c){
+	sim_cycles(SIM_HAL_CALL_CYC);
+	HAL_NVIC_DisableIRQ(I2C1_EV_IRQn);
+	HAL_NVIC_DisableIRQ(I2C1_ER_IRQn);
+	x.active = false;
+	x.irq = false;
+	sim_irq_clear(I2C1_EV_IRQn);
+	sim_irq_clear(I2C1_ER_IRQn);
+	sim_irq_clear(DMA1_Stream0_IRQn);
+	sim_irq_clear(DMA1_Stream6_IRQn);
+	sim_dev_kick(i2c_dev);
+	hi2c->State = HAL_I2C_STATE_RESET;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_IsDeviceReady(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint32_t Trials, uint32_t Timeout){
+	(void)Trials; (void)Timeout;
+	if(hi2c->State != HAL_I2C_STATE_READY) return HAL_BUSY;
+	sim_busy_ps(i2c_xfer_ps(0, true));
+	return DevAddress == DS_ADDR ? HAL_OK : HAL_ERROR;
+}
+
+/* mode: 0 = chờ xong (blocking), 1 = IT, 2 = DMA */
+static HAL_StatusTypeDef i2c_start(I2C_HandleTypeDef *hi2c, uint16_t dev, uint16_t reg,
+                                   uint8_t *buf, uint16_t len, bool write, int mode){
+	uint64_t dur;
+	sim_cycles(SIM_HAL_CALL_CYC);
+	if(hi2c->State != HAL_I2C_STATE_READY) return HAL_BUSY;
+	if(len == 0 || len > DS_NREGS) return HAL_ERROR;
+	sim_i2c_xfers++;
+	x.nack = dev != DS_ADDR;
+	x.write = write;
+	x.dma = mode == 2;
+	x.reg = (uint8_t)reg;
+	x.buf = buf;
+	x.len = len;
+	if(write) memcpy(x.data, buf, len);
+	else ds_read_regs((uint8_t)reg, x.data, len);
+	dur = i2c_xfer_ps(len, write);
+	hi2c->State = write ? HAL_I2C_STATE_BUSY_TX : HAL_I2C_STATE_BUSY_RX;
+
+	if(mode == 0){
+		sim_busy_ps(dur);
+		if(!x.nack){
+			if(write) ds_write_regs(x.reg, x.data, len);
+			else memcpy(buf, x.data, len);
+		}
+		hi2c->State = HAL_I2C_STATE_READY;
+		return x.nack ? HAL_ERROR : HAL_OK;
+	}
+	x.active = true;
+	x.done_ps = sim_ps + dur;
+	sim_dev_kick(i2c_dev);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                    uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout){
+	(void)MemAddSize; (void)Timeout;
+	return i2c_start(hi2c, DevAddress, MemAddress, pData, Size, true, 0);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                   uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout){
+	(void)MemAddSize; (void)Timeout;
+	return i2c_start(hi2c, DevAddress, MemAddress, pData, Size, false, 0);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                       uint16_t MemAddSize, uint8_t *pData, uint16_t Size){
+	(void)MemAddSize;
+	return i2c_start(hi2c, DevAddress, MemAddress, pData, Size, true, 1);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                      uint16_t MemAddSize, uint8_t *pData, uint16_t Size){
+	(void)MemAddSize;
+	return i2c_start(hi2c, DevAddress, MemAddress, pData, Size, false, 1);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                        uint16_t MemAddSize, uint8_t *pData, uint16_t Size){
+	(void)MemAddSize;
+	return i2c_start(hi2c, DevAddress, MemAddress, pData, Size, true, 2);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                       uint16_t MemAddSize, uint8_t *pData, uint16_t Size){
+	(void)MemAddSize;
+	return i2c_start(hi2c, DevAddress, MemAddress, pData, Size, false, 2);
+}
+
+/* utc: giờ chip lúc khởi động; ppm > 0: chip chạy nhanh */
+void sim_ds3231_init(uint32_t utc, int32_t ppm){
+	ds3231_time_t t;
+	memset(regs, 0, sizeof(regs));
+	ds_utc = utc;
+	ds_encode_time();
+	cal_from_sec(utc, &t);
+	regs[3] = t.day;
+	regs[DS_CONTROL] = 0x1C;			// mặc định khi cấp nguồn: INTCN = 1
+	regs[0x11] = 25;					// 25 °C
+	ds_period = (uint64_t)((int64_t)SIM_PS_PER_S - (int64_t)ppm * 1000000);
+	ds_next = sim_ps + ds_period / 2u;	// khởi động giữa một giây
+	sim_gpio_drive(RTC_SQW_GPIO_Port, RTC_SQW_Pin, GPIO_PIN_SET);	// kéo lên
+	ds_dev = sim_dev_add(ds_update);
+	i2c_dev = sim_dev_add(i2c_update);
+}
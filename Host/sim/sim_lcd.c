@@ -0,0 +1,194 @@
+/*
+ * sim_lcd.c
+ *
+ *  ILI9341 sau FSMC (bus 16 bit). lcd.c lấy LCD một lần cho mỗi thao tác
+ *  (ghi REG, ghi RAM hoặc đọc RAM); lần lấy kế tiếp xác định thao tác trước
+ *  là gì nhờ giá trị canh: REG khác LCD_REG_IDLE -> lệnh, RAM còn bit 16
+ *  -> là lần đọc (giá trị đọc nằm ở 16 bit thấp), ngược lại -> dữ liệu.
+ *
+ *  Thời gian bus tính theo chu kỳ HCLK như cấu hình FSMC (ADDSET + DATAST),
+ *  nên chạy ở clock thấp thì vẽ chậm đúng tỉ lệ.
+ */
+#include <string.h>
+#include "sim.h"
+#include "lcd.h"
+
+#define LCD_REG_IDLE		0xFFFFFFFFu
+#define LCD_RAM_READ		0x00010000u
+#define LCD_WR_CYC			SIM_FSMC_WR_CYC
+#define LCD_RD_CYC			SIM_FSMC_RD_CYC		// đọc GRAM của ILI9341 chậm hơn nhiều
+
+#define LCD_FB_W			320
+#define LCD_FB_H			320
+
+sim_lcd_stats_t sim_lcd_stats;
+
+static LCD_TypeDef port;
+static uint8_t armed = 0;
+static uint32_t debt_cyc = 0;		// thao tác được ghi nhận lúc harness đọc khung hình
+static uint16_t fb[LCD_FB_H][LCD_FB_W];
+
+static uint8_t cmd = 0;
+static uint8_t nparam = 0;
+static uint16_t xs, xe, ys, ye, cx, cy;
+static uint8_t madctl = 0;
+static uint8_t nread = 0;
+
+extern const unsigned char ascii_1608[][16];
+extern const unsigned char ascii_2412[][48];
+extern const unsigned char ascii_3216[][64];
+
+static uint16_t next_read(void){
+	static const uint16_t id4[] = { 0x00, 0x00, 0x93, 0x41 };
+	uint8_t i = nread++;
+	if(cmd == 0xD3) return i < 4 ? id4[i] : 0;
+	if(cmd == 0x2E && i > 0){				// sau byte giả: điểm ảnh tại con trỏ
+		uint16_t c = fb[cy][cx];
+		return (i & 1) ? (uint16_t)(c & 0xF800) : (uint16_t)((c & 0x1F) << 11);
+	}
+	return 0;
+}
+
+static void on_cmd(uint8_t c){
+	cmd = c;
+	nparam = 0;
+	nread = 0;
+	if(c == 0x2C || c == 0x2E){ cx = xs; cy = ys; }
+}
+
+static void on_data(uint16_t d){
+	switch(cmd){
+	case 0x2A:
+		if(nparam == 0) xs = (uint16_t)((d & 0xFF) << 8);
+		else if(nparam == 1) xs |= d & 0xFF;
+		else if(nparam == 2) xe = (uint16_t)((d & 0xFF) << 8);
+		else if(nparam == 3) xe |= d & 0xFF;
+		nparam++;
+		break;
+	case 0x2B:
+		if(nparam == 0) ys = (uint16_t)((d & 0xFF) << 8);
+		else if(nparam == 1) ys |= d & 0xFF;
+		else if(nparam == 2) ye = (uint16_t)((d & 0xFF) << 8);
+		else if(nparam == 3) ye |= d & 0xFF;
+		nparam++;
+		break;
+	case 0x36:
+		madctl = (uint8_t)d;
+		break;
+	case 0x2C:
+		if(cx < LCD_FB_W && cy < LCD_FB_H) fb[cy][cx] = d;
+		sim_lcd_stats.ram_writes++;
+		if(++cx > xe){
+			cx = xs;
+			if(++cy > ye) cy = ys;
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+/* Ghi nhận thao tác của lần lấy trước; trả về số chu kỳ bus của nó */
+static uint32_t commit(void){
+	uint32_t cyc = 0;
+	if(!armed) return 0;
+	armed = 0;
+	if(port.LCD_REG != LCD_REG_IDLE){
+		on_cmd((uint8_t)port.LCD_REG);
+		sim_lcd_stats.cmd_writes++;
+		cyc = LCD_WR_CYC;
+	} else if(!(port.LCD_RAM & LCD_RAM_READ)){
+		on_data((uint16_t)port.LCD_RAM);
+		sim_lcd_stats.data_writes++;
+		cyc = LCD_WR_CYC;
+	} else {
+		sim_lcd_stats.reads++;
+		cyc = LCD_RD_CYC;
+	}
+	port.LCD_REG = LCD_REG_IDLE;
+	port.LCD_RAM = LCD_RAM_READ | next_read();
+	return cyc;
+}
+
+LCD_TypeDef *sim_lcd_port(void){
+	uint32_t cyc = commit() + debt_cyc;
+	debt_cyc = 0;
+	if(cyc){
+		uint64_t t0 = sim_ps;
+		sim_cycles(cyc);
+		sim_lcd_stats.bus_ps += sim_ps - t0;
+	}
+	armed = 1;
+	return &port;
+}
+
+void sim_lcd_init(void){
+	memset(fb, 0, sizeof(fb));
+	memset(&sim_lcd_stats, 0, sizeof(sim_lcd_stats));
+	port.LCD_REG = LCD_REG_IDLE;
+	port.LCD_RAM = LCD_RAM_READ;
+	armed = 0;
+	debt_cyc = 0;
+	(void)madctl;
+}
+
+void sim_lcd_sync(void){
+	debt_cyc += commit();
+}
+
+uint16_t sim_lcd_pixel(uint16_t x, uint16_t y){
+	debt_cyc += commit();
+	return fb[y][x];
+}
+
+static const unsigned char *glyph(char c, uint8_t sizey){
+	int i = c - ' ';
+	if(sizey == 16) return ascii_1608[i];
+	if(sizey == 24) return ascii_2412[i];
+	if(sizey == 32) return ascii_3216[i];
+	return NULL;
+}
+
+/* So khung hình với cách lcd_ShowChar vẽ (mode 0): bit 1 = màu chữ */
+static bool glyph_matches(uint16_t x, uint16_t y, char c, uint8_t sizey, uint16_t x_end){
+	const unsigned char *g = glyph(c, sizey);
+	uint8_t sizex = sizey / 2, m = 0;
+	uint16_t n = (uint16_t)((sizex / 8 + ((sizex % 8) ? 1 : 0)) * sizey);
+	uint16_t px = 0, py = 0;
+	int fg = -1, bg = -1;
+	for(uint16_t i = 0; i < n; i++){
+		for(uint8_t t = 0; t < 8; t++){
+			if(x + px < x_end){
+				uint16_t col = fb[y + py][x + px];
+				int *want = (g[i] & (1u << t)) ? &fg : &bg;
+				if(*want < 0) *want = col;
+				else if(*want != col) return false;
+			}
+			if(++px == sizex){ px = 0; py++; }
+			m++;
+			if(m % sizex == 0){ m = 0; break; }
+		}
+	}
+	return fg < 0 || bg < 0 || fg != bg;
+}
+
+char sim_lcd_char_clip(uint16_t x, uint16_t y, uint8_t sizey, uint16_t x_end){
+	debt_cyc += commit();
+	if(!glyph(' ', sizey) || x + sizey / 2 > LCD_FB_W || y + sizey > LCD_FB_H) return 0;
+	/* Số trước: ô toàn nền cũng khớp ' ' */
+	for(char c = '0'; c <= '9'; c++) if(glyph_matches(x, y, c, sizey, x_end)) return c;
+	for(char c = ' '; c <= '~'; c++) if(glyph_matches(x, y, c, sizey, x_end)) return c;
+	return 0;
+}
+
+char sim_lcd_char(uint16_t x, uint16_t y, uint8_t sizey){
+	return sim_lcd_char_clip(x, y, sizey, LCD_FB_W);
+}
+
+void sim_lcd_str(uint16_t x, uint16_t y, uint8_t sizey, uint8_t n, char *out){
+	for(uint8_t i = 0; i < n; i++){
+		char c = sim_lcd_char((uint16_t)(x + i * (sizey / 2)), y, sizey);
+		out[i] = c ? c : '?';
+	}
+	out[n] = 0;
+}
@@ -0,0 +1,299 @@
+/*
+ * sim_main.c
+ *
+ *  Harness: dựng board như main.c (sim_board.c) rồi chạy đúng vòng lặp
+ *  chính của firmware trên HAL mô phỏng. Kịch bản mặc định chạy
+ *  24 giờ mô phỏng:
+ *    - mỗi giây, 30 ms sau khi DS3231 lật giây và 30 ms trước lần lật kế,
+ *      đọc HH:MM:SS trên khung hình và so với giờ của chip (UTC+7);
+ *    - sau 1 giờ: MODE x2 vào ALARM (đi qua SET nên giờ được ghi lại vào
+ *      chip), OK x3 bật báo thức 07:00:00, MODE vào bấm giờ, OK, 5 s sau
+ *      OK, khung phải hiện 00:05.00 ± 2 cs, rồi MODE x2 về VIEW;
+ *    - mỗi lần Alarm1 của chip khớp (INT kéo thấp): phải đúng 07:00:00 giờ
+ *      địa phương, 500 ms sau khung phải hiện "ALARM!" và A1F đã được
+ *      firmware xoá qua đường INT -> EXTI -> đọc/xoá status.
+ *  Trả về 0 nếu mọi kiểm tra đạt.
+ *
+ *  ./clock_sim [-H giờ] [-p ppm] [-q] [-t trace.bin] [-l dlog.bin]
+ *  -t: ghi trace_buf lúc kết thúc (như dump từ debugger) cho trace_dec
+ *  -l: luồng DLOG qua _write (như __io_putchar trên chip) cho dlog_dec -s
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sim.h"
+#include "calendar.h"
+#include "app_clock.h"
+#include "clock_gov.h"
+#include "prof.h"
+#include "sched.h"
+#include "software_timer.h"
+#include "trace.h"
+#include "workq.h"
+
+#define LOCAL_OFFSET_S		(7 * 3600)			// APP_TZ mặc định "ICT-7"
+#define CHECK_MARGIN_PS		(30 * SIM_PS_PER_MS)
+#define CHECK_SETTLE_S		5					// sau khi đổi mode
+#define CHECK_BOOT_S		60					// lclock slew pha tối đa 5 ms/s
+#define PRESS_MS			80					// > BUTTON_DEBOUNCE_US
+#define BTN_MODE			0
+#define BTN_OK				2
+#define ALARM_LOCAL_S		(7 * 3600)			// alarm1 mặc định của app_clock
+#define DS_STATUS_A1F		0x01
+#define ALARM_SHOW_MS		500					// hiệu ứng kéo dài 3 s
+
+/* ============ Kịch bản ============ */
+typedef struct {
+	uint64_t at_ps;
+	uint8_t idx;
+	bool press;
+} action_t;
+
+static action_t actions[32];
+static int n_actions = 0, next_action = 0;
+
+static uint64_t check_at = SIM_NEVER;
+static uint64_t checks_from_ps = CHECK_BOOT_S * SIM_PS_PER_S;
+static uint64_t sw_check_ps = SIM_NEVER;
+static uint64_t alarm_check_ps = SIM_NEVER;
+static uint32_t checks_ok = 0, checks_fail = 0, checks_skipped = 0;
+static bool sw_ok = false;
+static uint32_t alarm_utc;						// lần kích đầu tiên mong đợi
+static uint32_t alarm_seen = 0, alarm_ok = 0, alarm_want = 0;
+static int script_dev;
+static bool quiet = false;
+
+static void press(uint64_t at_ps, uint8_t idx){
+	actions[n_actions++] = (action_t){ at_ps, idx, true };
+	actions[n_actions++] = (action_t){ at_ps + PRESS_MS * SIM_PS_PER_MS, idx, false };
+}
+
+static void fail(const char *what, const char *want, const char *got){
+	checks_fail++;
+	if(checks_fail <= 10 || !quiet)
+		printf("FAIL %-9s t=%.3f s  muốn %s  thấy %s\n", what, (double)sim_ps / SIM_PS_PER_S, want, got);
+}
+
+static void check_time(void){
+	ds3231_time_t t;
+	char want[16], got[16], hh[3], mm[3], ss[3];
+	uint64_t next = sim_ds3231_next_tick_ps();
+
+	/* Chip vừa bị ghi (chuỗi chia đặt lại) hoặc đang đổi mode: không so */
+	if(sim_ps < checks_from_ps || next - sim_ps < CHECK_MARGIN_PS / 2){
+		checks_skipped++;
+		return;
+	}
+	cal_from_sec(sim_ds3231_utc() + LOCAL_OFFSET_S, &t);
+	/* lcd_ShowIntNum thay số 0 đứng đầu bằng khoảng trắng */
+	snprintf(want, sizeof(want), "%2u:%2u:%2u", t.hour, t.min, t.sec);
+	sim_lcd_str(70, 100, 24, 2, hh);
+	sim_lcd_str(110, 100, 24, 2, mm);
+	sim_lcd_str(150, 100, 24, 2, ss);
+	snprintf(got, sizeof(got), "%s:%s:%s", hh, mm, ss);
+	if(strcmp(want, got)) { fail("time", want, got); return; }
+
+	snprintf(want, sizeof(want), "%2u/%2u/%2u", t.date, t.month, t.year);
+	/* "Mo:" (x = 120) vẽ đè 4 cột cuối của chữ số hàng đơn vị ngày */
+	sim_lcd_str(100, 130, 24, 1, hh);
+	hh[1] = sim_lcd_char_clip(112, 130, 24, 120);
+	if(!hh[1]) hh[1] = '?';
+	hh[2] = 0;
+	sim_lcd_str(150, 130, 24, 2, mm);
+	sim_lcd_str(210, 130, 24, 2, ss);
+	snprintf(got, sizeof(got), "%s/%s/%s", hh, mm, ss);
+	if(strcmp(want, got)) { fail("date", want, got); return; }
+	checks_ok++;
+}
+
+static void check_stopwatch(void){
+	char mm[3], ss[3], cs[3], got[16];
+	sim_lcd_str(60, 100, 24, 2, mm);
+	sim_lcd_str(96, 100, 24, 2, ss);
+	sim_lcd_str(132, 100, 24, 2, cs);
+	snprintf(got, sizeof(got), "%s:%s.%s", mm, ss, cs);
+	/* Quét phím 10 ms và slew pha của lclock: cho phép lệch 2 cs */
+	sw_ok = !strncmp(got, "00:0", 4) && got[5] == '.' &&
+	        abs(atoi(&got[3]) * 100 + atoi(&got[6]) - 500) <= 2;
+	if(!sw_ok) fail("stopwatch", "00:05.00", got);
+	else if(!quiet) printf("stopwatch t=%.3f s  %s\n", (double)sim_ps / SIM_PS_PER_S, got);
+}
+
+/* Alarm1 của chip vừa khớp (thấy ở lần so giờ kế, <= 30 ms sau): đúng giờ chưa */
+static void check_alarm_match(void){
+	ds3231_time_t t;
+	char want[16], got[16];
+	uint32_t utc = sim_ds3231_a1_utc;
+	alarm_seen = sim_ds3231_a1_fires;
+	if(utc < alarm_utc || (utc - alarm_utc) % CAL_SEC_PER_DAY){
+		cal_from_sec(utc + LOCAL_OFFSET_S, &t);
+		snprintf(want, sizeof(want), "%02u:%02u:%02u", ALARM_LOCAL_S / 3600, ALARM_LOCAL_S / 60 % 60, ALARM_LOCAL_S % 60);
+		snprintf(got, sizeof(got), "%02u:%02u:%02u", t.hour, t.min, t.sec);
+		fail("alarm at", want, got);
+		return;
+	}
+	alarm_check_ps = sim_ps + ALARM_SHOW_MS * SIM_PS_PER_MS;
+}
+
+/* ALARM_SHOW_MS sau: firmware đã nhận INT, xoá cờ và vẽ hiệu ứng */
+static void check_alarm(void){
+	char got[16];
+	sim_lcd_str(70, 190, 24, 6, got);
+	if(strcmp(got, "ALARM!")) { fail("alarm lcd", "ALARM!", got); return; }
+	if(sim_ds3231_reg(0x0F) & DS_STATUS_A1F) { fail("alarm A1F", "0", "1"); return; }
+	alarm_ok++;
+	if(!quiet) printf("alarm     t=%.3f s  %s\n", (double)sim_ps / SIM_PS_PER_S, got);
+}
+
+/* Giữa hai lần lật giây của chip: +30 ms sau lần trước và -30 ms trước lần kế */
+static void schedule_check(void){
+	uint64_t tick = sim_ds3231_next_tick_ps();
+	check_at = (tick - CHECK_MARGIN_PS > sim_ps) ? tick - CHECK_MARGIN_PS : tick + CHECK_MARGIN_PS;
+}
+
+static uint64_t script_update(void){
+	uint64_t next;
+	while(next_action < n_actions && actions[next_action].at_ps <= sim_ps){
+		sim_button_set(actions[next_action].idx, actions[next_action].press);
+		next_action++;
+	}
+	if(sw_check_ps <= sim_ps){
+		sw_check_ps = SIM_NEVER;
+		check_stopwatch();
+	}
+	if(alarm_check_ps <= sim_ps){
+		alarm_check_ps = SIM_NEVER;
+		check_alarm();
+	}
+	if(check_at <= sim_ps){
+		if(sim_ds3231_a1_fires != alarm_seen) check_alarm_match();
+		check_time();
+		schedule_check();
+	}
+	next = check_at;
+	if(next_action < n_actions && actions[next_action].at_ps < next) next = actions[next_action].at_ps;
+	if(sw_check_ps < next) next = sw_check_ps;
+	if(alarm_check_ps < next) next = alarm_check_ps;
+	return next;
+}
+
+/* start_utc: giờ chip lúc sim_ps = 0 */
+static void script_init(double hours, uint32_t start_utc){
+	uint64_t t = 3600 * SIM_PS_PER_S;
+	uint32_t on_local, end_utc;
+	if(hours < 1.5) t = (uint64_t)(hours * 0.5 * 3600.0) * SIM_PS_PER_S;
+	/* VIEW -> SET -> ALARM, OK x3 (giờ, phút, giây: bật), -> STOPWATCH, OK, 5 s, OK,
+	 * -> COUNTDOWN -> VIEW */
+	press(t, BTN_MODE);
+	press(t + 300 * SIM_PS_PER_MS, BTN_MODE);
+	press(t + 600 * SIM_PS_PER_MS, BTN_OK);
+	press(t + 900 * SIM_PS_PER_MS, BTN_OK);
+	press(t + 1200 * SIM_PS_PER_MS, BTN_OK);
+	press(t + 1500 * SIM_PS_PER_MS, BTN_MODE);
+	press(t + 2000 * SIM_PS_PER_MS, BTN_OK);
+	press(t + 7000 * SIM_PS_PER_MS, BTN_OK);
+	sw_check_ps = t + 7500 * SIM_PS_PER_MS;
+	press(t + 8000 * SIM_PS_PER_MS, BTN_MODE);
+	press(t + 8300 * SIM_PS_PER_MS, BTN_MODE);
+
+	/* 07:00:00 địa phương đầu tiên sau lúc bật; số lần phải thấy tới hết giờ chạy
+	 * (chừa 5 s cho hiệu ứng và lần so giờ) */
+	on_local = start_utc + (uint32_t)(t / SIM_PS_PER_S) + 2u + LOCAL_OFFSET_S;
+	alarm_utc = on_local / CAL_SEC_PER_DAY * CAL_SEC_PER_DAY + ALARM_LOCAL_S - LOCAL_OFFSET_S;
+	if(alarm_utc + LOCAL_OFFSET_S <= on_local) alarm_utc += CAL_SEC_PER_DAY;
+	end_utc = start_utc + (uint32_t)(hours * 3600.0);
+	if(end_utc > alarm_utc + 5u) alarm_want = (end_utc - alarm_utc - 5u) / CAL_SEC_PER_DAY + 1u;
+	schedule_check();
+	script_dev = sim_dev_add(script_update);
+	(void)script_dev;
+}
+
+/* Giờ bị MODE đi qua SET không so trong cửa sổ kịch bản */
+static bool in_scenario(void){
+	return n_actions && sim_ps >= actions[0].at_ps &&
+	       sim_ps < actions[n_actions - 1].at_ps + CHECK_SETTLE_S * SIM_PS_PER_S;
+}
+
+/* ============ Báo cáo ============ */
+/* prof_dump đưa dòng kèm "\r\n" */
+static void put_line(const char *line){
+	printf("  %.*s\n", (int)strcspn(line, "\r\n"), line);
+}
+
+static void report(double host_s){
+	double sim_s = (double)sim_ps / SIM_PS_PER_S;
+	static const char *prof_names[CLK_PROFILE_N] = { "PERF", "MID", "LOW" };
+
+	printf("\n== %.2f h mô phỏng trong %.1f s máy (x%.0f) ==\n", sim_s / 3600.0, host_s, sim_s / host_s);
+	printf("time checks  %u đạt, %u lỗi, %u bỏ qua\n", checks_ok, checks_fail, checks_skipped);
+	printf("stopwatch    %s\n", sw_ok ? "5 s đạt" : "LỖI");
+	printf("alarm        %u/%u lần đạt (Alarm1 khớp %u lần)\n", alarm_ok, alarm_want, sim_ds3231_a1_fires);
+	printf("CPU          ngủ %.2f %%, %u ngắt, %u giao dịch I2C, %u lần quét SPI\n",
+	       100.0 * (double)sim_sleep_ps / (double)sim_ps, sim_irq_count, sim_i2c_xfers, sim_spi_xfers);
+	printf("LCD          %llu ghi dữ liệu, %llu lệnh, %llu đọc, %llu điểm ảnh, bus %.3f s (%.3f %%)\n",
+	       (unsigned long long)sim_lcd_stats.data_writes, (unsigned long long)sim_lcd_stats.cmd_writes,
+	       (unsigned long long)sim_lcd_stats.reads, (unsigned long long)sim_lcd_stats.ram_writes,
+	       (double)sim_lcd_stats.bus_ps / SIM_PS_PER_S, 100.0 * (double)sim_lcd_stats.bus_ps / (double)sim_ps);
+	printf("clock        ");
+	for(int p = 0; p < CLK_PROFILE_N; p++)
+		printf("%s %.2f %%  ", prof_names[p], 100.0 * (double)clk_gov_residency_us((clk_profile_t)p) / (sim_s * 1e6));
+	printf("\n");
+	printf("workq        sâu nhất %u, bỏ %u; timer2 lỡ %u\n", workq_max_depth, workq_dropped, timer2_missed);
+	printf("sched        quá hạn %u, lượt dài nhất %u us\n", sched_overruns(), sched_max_busy_us());
+	for(uint8_t i = 0; i < sched_task_count(); i++){
+		task_t *t = sched_task(i);
+		printf("  %-6s runs %-9u misses %-5u skipped %-5u exec max %-6u us  latency max %u us\n",
+		       t->name, t->runs, t->misses, t->skipped, t->max_exec_us, t->max_latency_us);
+	}
+	printf("prof (chu kỳ HCLK)\n");
+	prof_dump(put_line);
+}
+
+int main(int argc, char **argv){
+	double hours = 24.0;
+	int32_t ppm = 20;
+	ds3231_time_t start = { .sec = 0, .min = 0, .hour = 13, .date = 31, .month = 12, .year = 25 };
+	uint64_t end_ps;
+	clock_t c0;
+	const char *trace_path = NULL;
+	FILE *f;
+
+	for(int i = 1; i < argc; i++){
+		if(!strcmp(argv[i], "-H") && i + 1 < argc) hours = atof(argv[++i]);
+		else if(!strcmp(argv[i], "-p") && i + 1 < argc) ppm = atoi(argv[++i]);
+		else if(!strcmp(argv[i], "-q")) quiet = true;
+		else if(!strcmp(argv[i], "-t") && i + 1 < argc) trace_path = argv[++i];
+		else if(!strcmp(argv[i], "-l") && i + 1 < argc){
+			if(!sim_putchar_open(argv[++i])){
+				perror(argv[i]);
+				return 2;
+			}
+		}
+		else { fprintf(stderr, "dùng: %s [-H giờ] [-p ppm] [-q] [-t trace.bin] [-l dlog.bin]\n", argv[0]); return 2; }
+	}
+	/* 2025-12-31 13:00 UTC = 20:00 giờ VN: qua nửa đêm, sang tháng và năm mới */
+	start.day = cal_weekday(start.date, start.month, start.year);
+	end_ps = (uint64_t)(hours * 3600.0 * 1e6) * SIM_PS_PER_US;
+
+	c0 = clock();
+	sim_board_init(cal_to_sec(&start), ppm);
+	sim_firmware_init();
+	script_init(hours, cal_to_sec(&start));
+
+	while(sim_ps < end_ps){
+		sim_main_step();
+		if(in_scenario()) checks_from_ps = sim_ps + CHECK_SETTLE_S * SIM_PS_PER_S;
+	}
+
+	report((double)(clock() - c0) / CLOCKS_PER_SEC);
+	if(trace_path){
+		if(!(f = fopen(trace_path, "wb")) || fwrite(&trace_buf, sizeof(trace_buf), 1, f) != 1){
+			perror(trace_path);
+			return 2;
+		}
+		fclose(f);
+	}
+	return (checks_fail || !sw_ok || !checks_ok || alarm_ok != alarm_want ||
+	        sim_ds3231_a1_fires != alarm_want) ? 1 : 0;
+}
@@ -0,0 +1,201 @@
+/*
+ * dlog_dec.c
+ *
+ *  Định dạng lại log DLOG (dlog.h) trên máy tính: chuỗi định dạng lấy từ
+ *  section dlog_fmt của file ELF (firmware ARM hoặc clock_sim), tham số từ
+ *    - ảnh dlog_buf (dump từ debugger), mặc định;
+ *    - -s: luồng nhị phân đi qua _write (hdr, ts, tham số).
+ *
+ *  ./dlog_dec [-s] firmware.elf file
+ */
+#include <elf.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dlog.h"
+
+static const char *fmt_sec;		// nội dung section dlog_fmt
+static size_t fmt_len;
+
+/* ============ ELF ============ */
+static void *load_file(const char *path, size_t *len){
+	FILE *f = fopen(path, "rb");
+	char *buf;
+	long n;
+	if(!f || fseek(f, 0, SEEK_END) || (n = ftell(f)) < 0 || fseek(f, 0, SEEK_SET)){
+		perror(path);
+		exit(2);
+	}
+	if(!(buf = malloc((size_t)n + 1)) || fread(buf, 1, (size_t)n, f) != (size_t)n){
+		perror(path);
+		exit(2);
+	}
+	buf[n] = 0;
+	fclose(f);
+	*len = (size_t)n;
+	return buf;
+}
+
+/* ELF32 (chip) hoặc ELF64 (host), little-endian */
+#define FIND_SECTION(Ehdr, Shdr) do { \
+		const Ehdr *eh = (const Ehdr *)elf; \
+		const Shdr *sh = (const Shdr *)(elf + eh->e_shoff); \
+		const char *names = elf + sh[eh->e_shstrndx].sh_offset; \
+		for(unsigned i = 0; i < eh->e_shnum; i++){ \
+			if(strcmp(names + sh[i].sh_name, "dlog_fmt")) continue; \
+			fmt_sec = elf + sh[i].sh_offset; \
+			fmt_len = sh[i].sh_size; \
+			return; \
+		} \
+	} while(0)
+
+static void load_fmt(const char *path){
+	size_t len;
+	const char *elf = load_file(path, &len);
+	if(len < EI_NIDENT || memcmp(elf, ELFMAG, SELFMAG) || elf[EI_DATA] != ELFDATA2LSB){
+		fprintf(stderr, "%s: không phải ELF little-endian\n", path);
+		exit(2);
+	}
+	if(elf[EI_CLASS] == ELFCLASS32) FIND_SECTION(Elf32_Ehdr, Elf32_Shdr);
+	else FIND_SECTION(Elf64_Ehdr, Elf64_Shdr);
+	fprintf(stderr, "%s: không có section dlog_fmt (bản build không DEBUG?)\n", path);
+	exit(2);
+}
+
+/* ============ Định dạng ============ */
+static void put_arg(const char *spec, char conv, uint32_t a){
+	switch(conv){
+	case 'd': case 'i':
+		printf(spec, (int)(int32_t)a);
+		break;
+	case 'u': case 'x': case 'X': case 'o':
+		printf(spec, (unsigned)a);
+		break;
+	case 'c':
+		printf(spec, (int)(a & 0xFF));
+		break;
+	case 'p':
+		printf("0x%08x", a);
+		break;
+	default:
+		printf("<%%%c?>", conv);
+		break;
+	}
+}
+
+/* Chỉ số nguyên 32 bit: bỏ h/l/z..., %s và %f không có dữ liệu để in */
+static void format(const char *fmt, const uint32_t *arg, unsigned n){
+	char spec[16];
+	unsigned used = 0;
+	while(*fmt){
+		size_t k = 0;
+		if(*fmt != '%'){
+			putchar(*fmt++);
+			continue;
+		}
+		fmt++;
+		if(*fmt == '%'){
+			putchar(*fmt++);
+			continue;
+		}
+		spec[k++] = '%';
+		while(*fmt && strchr("-+ #0123456789.", *fmt) && k < sizeof(spec) - 2) spec[k++] = *fmt++;
+		while(*fmt && strchr("hlLqjzt", *fmt)) fmt++;
+		if(!*fmt) break;
+		spec[k++] = *fmt;
+		spec[k] = 0;
+		if(used < n) put_arg(spec, *fmt, arg[used++]);
+		else printf("<?>");
+		fmt++;
+	}
+	putchar('\n');
+}
+
+/* ============ Bản ghi ============ */
+static uint64_t t_us;
+static uint32_t last_ts;
+static bool have_ts;
+
+static bool print_rec(uint32_t hdr, uint32_t ts, const uint32_t *arg){
+	uint32_t off = hdr & 0x00FFFFFFu, n = hdr >> 28;
+	if(off >= fmt_len || n > DLOG_ARGS_MAX) return false;
+	/* TIM2 32 bit µs: cộng dồn hiệu để qua được lần tràn (71 phút) */
+	if(have_ts) t_us += (uint32_t)(ts - last_ts);
+	else t_us = ts;
+	last_ts = ts;
+	have_ts = true;
+	printf("%14.6f  ", (double)t_us / 1e6);
+	format(fmt_sec + off, arg, n);
+	return true;
+}
+
+static void load_buf(FILE *f, const char *path){
+	dlog_buf_t b;
+	dlog_rec_t *ring;
+	uint32_t n, first;
+	if(fread(&b, 1, offsetof(dlog_buf_t, rec), f) != offsetof(dlog_buf_t, rec) ||
+	   b.magic != DLOG_MAGIC || !b.n || (b.n & (b.n - 1))){
+		fprintf(stderr, "%s: không phải ảnh dlog_buf (magic/n sai)\n", path);
+		exit(2);
+	}
+	if(!(ring = malloc(b.n * sizeof(*ring))) || fread(ring, sizeof(*ring), b.n, f) != b.n){
+		fprintf(stderr, "%s: thiếu bản ghi (cần %u)\n", path, b.n);
+		exit(2);
+	}
+	n = (b.head < b.n) ? b.head : b.n;
+	first = b.head - n;
+	for(uint32_t i = 0; i < n; i++){
+		const dlog_rec_t *r = &ring[(first + i) & (b.n - 1)];
+		if(!print_rec(r->hdr, r->ts, r->arg)) printf("(bản ghi hỏng 0x%08x)\n", r->hdr);
+	}
+	printf("%u bản ghi, %u bị ghi đè trước khi gửi\n", b.head, b.dropped);
+	free(ring);
+}
+
+/* Bản ghi dài 2 + n word; hdr hỏng thì trượt 1 word để bắt lại nhịp */
+static void load_stream(FILE *f){
+	uint32_t w[2 + DLOG_ARGS_MAX];
+	unsigned have = 0, recs = 0, bad = 0;
+	while(fread(&w[have], 4, 1, f) == 1){
+		have++;
+		if(have < 2) continue;
+		if((w[0] >> 28) > DLOG_ARGS_MAX || (w[0] & 0x00FFFFFFu) >= fmt_len){
+			memmove(w, w + 1, --have * 4);
+			bad++;
+			continue;
+		}
+		if(have < 2 + (w[0] >> 28)) continue;
+		print_rec(w[0], w[1], &w[2]);
+		recs++;
+		have = 0;
+	}
+	printf("%u bản ghi, %u word bỏ qua\n", recs, bad);
+}
+
+int main(int argc, char **argv){
+	const char *elf = NULL, *path = NULL;
+	bool stream = false;
+	FILE *f;
+
+	for(int i = 1; i < argc; i++){
+		if(!strcmp(argv[i], "-s")) stream = true;
+		else if(!elf) elf = argv[i];
+		else if(!path) path = argv[i];
+		else { path = NULL; break; }
+	}
+	if(!elf || !path){
+		fprintf(stderr, "dùng: %s [-s] firmware.elf file\n", argv[0]);
+		return 2;
+	}
+	load_fmt(elf);
+	if(!(f = fopen(path, "rb"))){
+		perror(path);
+		return 2;
+	}
+	if(stream) load_stream(f);
+	else load_buf(f, path);
+	fclose(f);
+	return 0;
+}
@@ -0,0 +1,342 @@
+/*
+ * stack_est.c
+ *
+ *  Ước lượng stack MSP xấu nhất từ bản build chip:
+ *    - khung mỗi hàm: file .su của -fstack-usage (Debug/Core/Src/<tên>.su...);
+ *    - đồ thị gọi: bl/blx/b.w tới hàm khác trong Lab3.list (objdump -d);
+ *    - lời gọi qua con trỏ, mức ưu tiên NVIC, hàm thư viện không có .su:
+ *      file cấu hình (tools/stack_est.cfg).
+ *
+ *  Mỗi ISR tốn khung hàm sâu nhất + khung ngắt phần cứng (có FPU: 104 byte).
+ *  Lồng nhau xấu nhất = luồng chính + ISR nặng nhất của từng mức ưu tiên
+ *  (NVIC_PRIORITYGROUP_4: mọi bit là preempt, mức nhỏ hơn ngắt được mức lớn).
+ *
+ *  ./stack_est -c stack_est.cfg [-L STM32F407ZGTX_FLASH.ld | -b byte] Lab3.list *.su
+ *  Mã thoát: 0 vừa ngân sách, 1 vượt, 2 lỗi dùng/đọc file.
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#define HASH_N		8192		// lũy thừa 2, > số hàm trong Lab3.list
+#define ROOTS_MAX	32
+#define LINE_MAX_	1024
+
+typedef struct {
+	char *name;
+	int size;			// byte, -1: chưa biết
+	bool dynamic;		// .su ghi "dynamic": có alloca/VLA
+	bool indirect;		// có blx rN / bx rN
+	bool cfg_calls;		// đã khai báo đích gọi gián tiếp trong cfg
+	bool recursive;
+	int *callee;
+	int ncallee, cap;
+	int worst;			// size + callee sâu nhất
+	int next;			// callee sâu nhất, -1: lá
+	unsigned char state;	// 0 chưa thăm, 1 đang thăm, 2 xong
+} fn_t;
+
+typedef struct {
+	int fn;
+	int prio;			// -1: luồng chính
+} root_t;
+
+static fn_t *fns;
+static int nfns, capfns;
+static int hash[HASH_N];
+static root_t roots[ROOTS_MAX];
+static int nroots;
+static int frame = 104;
+
+/* ============ Bảng hàm ============ */
+static unsigned hash_str(const char *s){
+	unsigned h = 2166136261u;
+	while(*s) h = (h ^ (unsigned char)*s++) * 16777619u;
+	return h;
+}
+
+static int fn_find(const char *name){
+	unsigned h = hash_str(name) & (HASH_N - 1);
+	while(hash[h]){
+		if(!strcmp(fns[hash[h] - 1].name, name)) return hash[h] - 1;
+		h = (h + 1) & (HASH_N - 1);
+	}
+	return -1;
+}
+
+static int fn_get(const char *name){
+	int i = fn_find(name);
+	unsigned h;
+	if(i >= 0) return i;
+	if(nfns + 1 >= HASH_N / 2){
+		fprintf(stderr, "quá nhiều hàm (tăng HASH_N)\n");
+		exit(2);
+	}
+	if(nfns == capfns){
+		capfns = capfns ? capfns * 2 : 256;
+		fns = realloc(fns, (size_t)capfns * sizeof(*fns));
+		if(!fns){
+			perror("realloc");
+			exit(2);
+		}
+	}
+	memset(&fns[nfns], 0, sizeof(*fns));
+	fns[nfns].name = strdup(name);
+	fns[nfns].size = -1;
+	fns[nfns].next = -1;
+	h = hash_str(name) & (HASH_N - 1);
+	while(hash[h]) h = (h + 1) & (HASH_N - 1);
+	hash[h] = nfns + 1;
+	return nfns++;
+}
+
+static void fn_call(int from, int to){
+	fn_t *f = &fns[from];
+	if(from == to) return;
+	for(int i = 0; i < f->ncallee; i++) if(f->callee[i] == to) return;
+	if(f->ncallee == f->cap){
+		f->cap = f->cap ? f->cap * 2 : 8;
+		f->callee = realloc(f->callee, (size_t)f->cap * sizeof(int));
+		if(!f->callee){
+			perror("realloc");
+			exit(2);
+		}
+	}
+	f->callee[f->ncallee++] = to;
+}
+
+static FILE *open_or_die(const char *path){
+	FILE *f = fopen(path, "r");
+	if(!f){
+		perror(path);
+		exit(2);
+	}
+	return f;
+}
+
+static void chomp(char *s){
+	size_t n = strlen(s);
+	while(n && isspace((unsigned char)s[n - 1])) s[--n] = 0;
+}
+
+/* ============ .su: "lcd.c:16:6:LCD_WR_REG\t16\tstatic" ============ */
+static void load_su(const char *path){
+	FILE *f = open_or_die(path);
+	char line[LINE_MAX_];
+	while(fgets(line, sizeof(line), f)){
+		char *t1 = strchr(line, '\t'), *t2, *name;
+		int i, n;
+		if(!t1 || !(t2 = strchr(t1 + 1, '\t'))) continue;
+		*t1 = 0;
+		chomp(t2 + 1);
+		name = strrchr(line, ':');
+		name = name ? name + 1 : line;
+		n = atoi(t1 + 1);
+		i = fn_get(name);
+		/* cùng tên ở hai file (hàm static): lấy cái lớn hơn */
+		if(n > fns[i].size) fns[i].size = n;
+		if(strstr(t2 + 1, "dynamic")) fns[i].dynamic = true;
+	}
+	fclose(f);
+}
+
+/* ============ Lab3.list ============ */
+/* " 8000554:\tf000 fd9c \tbl\t8001090 <ds3231_ReadTime>" */
+static void load_list(const char *path){
+	FILE *f = open_or_die(path);
+	char line[LINE_MAX_];
+	int cur = -1;
+	while(fgets(line, sizeof(line), f)){
+		char *fld[4], *p = line, *lt, *gt;
+		int k;
+		chomp(line);
+		/* "08000188 <name>:" */
+		if(isxdigit((unsigned char)line[0]) && (lt = strstr(line, " <")) && (gt = strstr(lt, ">:"))){
+			*gt = 0;
+			cur = fn_get(lt + 2);
+			continue;
+		}
+		if(cur < 0 || line[0] != ' ') continue;
+		for(k = 0; k < 4 && p; k++){
+			fld[k] = p;
+			if((p = strchr(p, '\t'))) *p++ = 0;
+		}
+		if(k < 4) continue;
+		chomp(fld[2]);
+		if(fld[2][0] != 'b') continue;
+		if(!strcmp(fld[2], "blx") || !strcmp(fld[2], "bx")){
+			if(fld[3][0] == 'r' && strcmp(fld[3], "lr")) fns[cur].indirect = true;
+			if(fld[3][0] == 'r') continue;
+		}
+		/* đích là đầu hàm khác: gọi, hoặc tail call với b/b.w; có +0x.. là nhảy trong hàm */
+		if(!(lt = strchr(fld[3], '<')) || !(gt = strchr(lt, '>'))) continue;
+		*gt = 0;
+		if(strchr(lt + 1, '+')) continue;
+		fn_call(cur, fn_get(lt + 1));
+	}
+	fclose(f);
+}
+
+/* ============ cfg ============ */
+static void load_cfg(const char *path){
+	FILE *f = open_or_die(path);
+	char line[LINE_MAX_];
+	int ln = 0;
+	while(fgets(line, sizeof(line), f)){
+		char *tok[16], *save = NULL, *s;
+		int n = 0;
+		ln++;
+		if((s = strchr(line, '#'))) *s = 0;
+		for(s = strtok_r(line, " \t\r\n", &save); s && n < 16; s = strtok_r(NULL, " \t\r\n", &save)) tok[n++] = s;
+		if(!n) continue;
+		if(!strcmp(tok[0], "frame") && n == 2) frame = atoi(tok[1]);
+		else if(!strcmp(tok[0], "size") && n == 3) fns[fn_get(tok[1])].size = atoi(tok[2]);
+		else if((!strcmp(tok[0], "thread") && n == 2) || (!strcmp(tok[0], "isr") && n == 3)){
+			if(nroots == ROOTS_MAX){
+				fprintf(stderr, "%s:%d: quá %d gốc\n", path, ln, ROOTS_MAX);
+				exit(2);
+			}
+			roots[nroots].fn = fn_get(tok[1]);
+			roots[nroots].prio = (n == 3) ? atoi(tok[2]) : -1;
+			nroots++;
+		}
+		else if(!strcmp(tok[0], "call") && n >= 3){
+			int from = fn_get(tok[1]);
+			fns[from].cfg_calls = true;
+			for(int i = 2; i < n; i++) fn_call(from, fn_get(tok[i]));
+		}
+		else {
+			fprintf(stderr, "%s:%d: không hiểu '%s'\n", path, ln, tok[0]);
+			exit(2);
+		}
+	}
+	fclose(f);
+}
+
+/* "_Min_Stack_Size = 0x400;" */
+static int load_budget(const char *path){
+	FILE *f = open_or_die(path);
+	char line[LINE_MAX_], *p;
+	int n = -1;
+	while(fgets(line, sizeof(line), f)){
+		if(!(p = strstr(line, "_Min_Stack_Size")) || !(p = strchr(p, '='))) continue;
+		n = (int)strtol(p + 1, NULL, 0);
+		break;
+	}
+	fclose(f);
+	if(n <= 0){
+		fprintf(stderr, "%s: không thấy _Min_Stack_Size\n", path);
+		exit(2);
+	}
+	return n;
+}
+
+/* ============ Tính ============ */
+static int worst(int i){
+	fn_t *f = &fns[i];
+	int best = 0;
+	if(f->state == 2) return f->worst;
+	if(f->state == 1){
+		f->recursive = true;	// đệ quy: không có chặn trên, chỉ tính một vòng
+		return 0;
+	}
+	f->state = 1;
+	for(int k = 0; k < f->ncallee; k++){
+		int w = worst(f->callee[k]);
+		if(w > best || f->next < 0){
+			best = w;
+			f->next = f->callee[k];
+		}
+	}
+	f->worst = (f->size > 0 ? f->size : 0) + best;
+	f->state = 2;
+	return f->worst;
+}
+
+static void print_path(int i){
+	printf("    ");
+	for(int k = 0; i >= 0 && k < 64; i = fns[i].next, k++){
+		if(fns[i].size >= 0) printf("%s%s(%d)", k ? " > " : "", fns[i].name, fns[i].size);
+		else printf("%s%s(?)", k ? " > " : "", fns[i].name);
+	}
+	printf("\n");
+}
+
+static void print_warnings(void){
+	bool any;
+	printf("\nCần xem lại (trong đồ thị đã duyệt):\n");
+	any = false;
+	printf("  không rõ khung (thêm 'size' vào cfg):");
+	for(int i = 0; i < nfns; i++) if(fns[i].state && fns[i].size < 0){ printf(" %s", fns[i].name); any = true; }
+	printf(any ? "\n" : " -\n");
+	any = false;
+	printf("  gọi qua con trỏ chưa khai báo (thêm 'call'):");
+	for(int i = 0; i < nfns; i++) if(fns[i].state && fns[i].indirect && !fns[i].cfg_calls){ printf(" %s", fns[i].name); any = true; }
+	printf(any ? "\n" : " -\n");
+	any = false;
+	printf("  khung động (alloca/VLA):");
+	for(int i = 0; i < nfns; i++) if(fns[i].state && fns[i].dynamic){ printf(" %s", fns[i].name); any = true; }
+	printf(any ? "\n" : " -\n");
+	any = false;
+	printf("  đệ quy (chỉ tính một vòng):");
+	for(int i = 0; i < nfns; i++) if(fns[i].recursive){ printf(" %s", fns[i].name); any = true; }
+	printf(any ? "\n" : " -\n");
+}
+
+int main(int argc, char **argv){
+	const char *cfg = NULL, *ld = NULL, *list = NULL;
+	int budget = -1, total = 0, thread = 0;
+	int nsu = 0;
+
+	for(int i = 1; i < argc; i++){
+		if(!strcmp(argv[i], "-c") && i + 1 < argc) cfg = argv[++i];
+		else if(!strcmp(argv[i], "-L") && i + 1 < argc) ld = argv[++i];
+		else if(!strcmp(argv[i], "-b") && i + 1 < argc) budget = atoi(argv[++i]);
+		else if(strstr(argv[i], ".su")){ load_su(argv[i]); nsu++; }
+		else if(!list) list = argv[i];
+		else { list = NULL; break; }
+	}
+	if(!cfg || !list || !nsu){
+		fprintf(stderr, "dùng: %s -c stack_est.cfg [-L file.ld | -b byte] Lab3.list file.su...\n", argv[0]);
+		return 2;
+	}
+	load_list(list);
+	load_cfg(cfg);
+	if(ld) budget = load_budget(ld);
+	if(!nroots){
+		fprintf(stderr, "%s: không có 'thread'/'isr'\n", cfg);
+		return 2;
+	}
+
+	/* printf đếm byte, không đếm ký tự: tiêu đề có dấu viết sẵn */
+	printf("gốc                         mức     hàm  +khung\n");
+	for(int r = 0; r < nroots; r++){
+		int w = worst(roots[r].fn);
+		if(roots[r].prio < 0){
+			printf("%-24s %6s %7d %7s\n", fns[roots[r].fn].name, "-", w, "-");
+			if(w > thread) thread = w;
+		}
+		else printf("%-24s %6d %7d %7d\n", fns[roots[r].fn].name, roots[r].prio, w, w + frame);
+		print_path(roots[r].fn);
+	}
+
+	/* mỗi mức ưu tiên lồng được một lần: cộng ISR nặng nhất của từng mức */
+	total = thread;
+	printf("\nLồng nhau xấu nhất: luồng chính %d", thread);
+	for(int p = 255; p >= 0; p--){
+		int best = -1;
+		for(int r = 0; r < nroots; r++)
+			if(roots[r].prio == p && (best < 0 || fns[roots[r].fn].worst > fns[roots[best].fn].worst)) best = r;
+		if(best < 0) continue;
+		total += fns[roots[best].fn].worst + frame;
+		printf(" + %s %d", fns[roots[best].fn].name, fns[roots[best].fn].worst + frame);
+	}
+	printf(" = %d byte", total);
+	if(budget > 0) printf(" / %d (%s)\n", budget, total > budget ? "VƯỢT" : "vừa");
+	else printf("\n");
+
+	print_warnings();
+	return (budget > 0 && total > budget) ? 1 : 0;
+}
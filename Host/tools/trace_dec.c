@@ -0,0 +1,200 @@
+/*
+ * trace_dec.c
+ *
+ *  Giải mã vết sự kiện (trace.h) thành dòng thời gian:
+ *    - mặc định: ảnh trace_buf (dump từ debugger hoặc clock_sim -t);
+ *    - -i: luồng ITM/SWO thô đã ghi ra file, lấy các word của cổng
+ *      TRACE_ITM_PORT (hoặc -p cổng), 4 word một bản ghi.
+ *  Thời gian quy từ DWT->CYCCNT theo HCLK, đổi tần số ở mỗi TRACE_CLK.
+ *
+ *  ./trace_dec [-i] [-p cổng] file
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "trace.h"
+
+static const char *names[TRACE_ID_N] = {
+	[TRACE_NONE]       = "none",
+	[TRACE_TASK]       = "task",
+	[TRACE_TASK_END]   = "task end",
+	[TRACE_I2C_START]  = "i2c start",
+	[TRACE_I2C_DONE]   = "i2c done",
+	[TRACE_SPI_SCAN]   = "spi scan",
+	[TRACE_SPI_DONE]   = "spi done",
+	[TRACE_DRAW_BEGIN] = "draw",
+	[TRACE_DRAW_END]   = "draw end",
+	[TRACE_MODE]       = "mode",
+	[TRACE_CLK]        = "clock",
+};
+
+static const char *modes[] = { "VIEW", "SET", "ALARM", "STOPWATCH", "COUNTDOWN" };
+
+static trace_rec_t *recs;
+static size_t n_recs, cap_recs;
+
+static void add(const trace_rec_t *r){
+	if(n_recs == cap_recs){
+		cap_recs = cap_recs ? cap_recs * 2 : 1024;
+		recs = realloc(recs, cap_recs * sizeof(*recs));
+		if(!recs){ perror("realloc"); exit(2); }
+	}
+	recs[n_recs++] = *r;
+}
+
+/* ============ Nguồn ============ */
+/* Header rồi b.n bản ghi; b.n theo TRACE_RING_N của bản build đã ghi ra */
+static uint32_t load_buf(FILE *f, const char *path){
+	trace_buf_t b;
+	trace_rec_t *ring;
+	uint32_t n, first;
+	if(fread(&b, 1, offsetof(trace_buf_t, rec), f) != offsetof(trace_buf_t, rec) ||
+	   b.magic != TRACE_MAGIC || !b.n || (b.n & (b.n - 1))){
+		fprintf(stderr, "%s: không phải ảnh trace_buf (magic/n sai)\n", path);
+		exit(2);
+	}
+	if(!(ring = malloc(b.n * sizeof(*ring))) || fread(ring, sizeof(*ring), b.n, f) != b.n){
+		fprintf(stderr, "%s: thiếu bản ghi (cần %u)\n", path, b.n);
+		exit(2);
+	}
+	n = (b.head < b.n) ? b.head : b.n;
+	first = b.head - n;
+	for(uint32_t i = 0; i < n; i++) add(&ring[(first + i) & (b.n - 1)]);
+	free(ring);
+	return b.hz;
+}
+
+/* Gói ITM: header 1 byte, bit [1:0] = kích thước, bit 2 = nguồn phần cứng (DWT),
+ * bit [1:0] = 0 là gói giao thức (đồng bộ, tràn, timestamp) */
+static void load_itm(FILE *f, unsigned port){
+	uint32_t words[4];
+	int nw = 0, c;
+	while((c = fgetc(f)) != EOF){
+		unsigned size = c & 3;
+		if(size){
+			uint32_t w = 0;
+			unsigned len = (size == 3) ? 4 : size;
+			for(unsigned i = 0; i < len; i++){
+				int b = fgetc(f);
+				if(b == EOF) return;
+				w |= (uint32_t)b << (8 * i);
+			}
+			if((c & 4) || (unsigned)(c >> 3) != port || len != 4) continue;
+			words[nw++] = w;
+			if(nw == 4){
+				add((const trace_rec_t *)words);
+				nw = 0;
+			}
+		} else if(c == 0x70){
+			fprintf(stderr, "ITM tràn: có thể mất bản ghi\n");
+		} else if(c & 0x80){
+			while(((c = fgetc(f)) != EOF) && (c & 0x80));		// timestamp/extension
+		}
+	}
+}
+
+/* ============ In ============ */
+static void put_tag(char *s, uint32_t tag){
+	for(int i = 0; i < 4; i++) s[i] = (char)(tag >> (8 * i)) ? (char)(tag >> (8 * i)) : ' ';
+	s[4] = 0;
+}
+
+static const char *mode_name(uint32_t m){
+	return (m < sizeof(modes) / sizeof(modes[0])) ? modes[m] : "?";
+}
+
+static void print_args(const trace_rec_t *r){
+	char tag[5];
+	switch(r->id){
+	case TRACE_TASK:
+		put_tag(tag, r->a0);
+		printf("%s  trễ %u us", tag, r->a1);
+		break;
+	case TRACE_TASK_END:
+		put_tag(tag, r->a0);
+		printf("%s  chạy %u us", tag, r->a1);
+		break;
+	case TRACE_I2C_START:
+		printf("%s 0x%02x x%u  chờ %u", (r->a0 >> 16) & 1 ? "ghi" : "đọc", r->a0 & 0xFF, (r->a0 >> 8) & 0xFF, r->a1);
+		break;
+	case TRACE_I2C_DONE:
+		printf("%s", r->a0 == 0 ? "OK" : r->a0 == 1 ? "ERROR" : r->a0 == 2 ? "BUSY" : "TIMEOUT");
+		break;
+	case TRACE_SPI_SCAN:
+		break;
+	case TRACE_SPI_DONE:
+		printf("0x%04x", r->a0 & 0xFFFF);
+		break;
+	case TRACE_DRAW_BEGIN:
+		printf("vùng 0x%02x  %s", r->a0, mode_name(r->a1));
+		break;
+	case TRACE_DRAW_END:
+		printf("vùng 0x%02x", r->a0);
+		break;
+	case TRACE_MODE:
+		printf("%s -> %s", mode_name(r->a0), mode_name(r->a1));
+		break;
+	case TRACE_CLK:
+		printf("%u -> %u MHz", r->a1 / 1000000u, r->a0 / 1000000u);
+		break;
+	default:
+		printf("0x%08x 0x%08x", r->a0, r->a1);
+		break;
+	}
+}
+
+int main(int argc, char **argv){
+	const char *path = NULL;
+	bool itm = false;
+	unsigned port = TRACE_ITM_PORT;
+	uint32_t hz = 0, lost = 0;
+	double t_us = 0;
+	FILE *f;
+
+	for(int i = 1; i < argc; i++){
+		if(!strcmp(argv[i], "-i")) itm = true;
+		else if(!strcmp(argv[i], "-p") && i + 1 < argc) port = (unsigned)atoi(argv[++i]);
+		else if(!path && argv[i][0] != '-') path = argv[i];
+		else { path = NULL; break; }
+	}
+	if(!path){
+		fprintf(stderr, "dùng: %s [-i] [-p cổng] file\n", argv[0]);
+		return 2;
+	}
+	if(!(f = fopen(path, "rb"))){
+		perror(path);
+		return 2;
+	}
+	if(itm) load_itm(f, port);
+	else hz = load_buf(f, path);
+	fclose(f);
+
+	/* Tần số lúc bản ghi cũ nhất: HCLK cũ của TRACE_CLK đầu tiên, không có thì tần số hiện tại */
+	for(size_t i = 0; i < n_recs; i++){
+		if(recs[i].id == TRACE_CLK){
+			hz = recs[i].a1;
+			break;
+		}
+	}
+	if(!hz) hz = 168000000u;
+
+	printf("%14s %10s  %-10s\n", "t (us)", "dt (us)", "sự kiện");
+	for(size_t i = 0; i < n_recs; i++){
+		const trace_rec_t *r = &recs[i];
+		double dt = 0;
+		if(i){
+			/* CYCCNT 32 bit: đúng nếu hai bản ghi cách nhau < 2^32 chu kỳ (25 s ở 168 MHz) */
+			dt = (double)(uint32_t)(r->ts - recs[i - 1].ts) * 1e6 / hz;
+			if((uint16_t)(r->seq - recs[i - 1].seq) != 1) lost += (uint16_t)(r->seq - recs[i - 1].seq - 1);
+		}
+		t_us += dt;
+		printf("%14.3f %10.3f  %-10s ", t_us, dt, r->id < TRACE_ID_N ? names[r->id] : "?");
+		print_args(r);
+		printf("\n");
+		if(r->id == TRACE_CLK) hz = r->a0;
+	}
+	printf("%zu bản ghi, mất %u\n", n_recs, lost);
+	return 0;
+}